@@ -22,14 +22,22 @@ import pprint
 
 data = []
 ranges = []
+block_index = []
+blocks = []
 
 template_main="""// This is a generated file. See emoji.py for details
 // clang-format off
 static std::vector<EmojiRegistry::Group> db = {{{groups}
 }};
 
-static std::map<quint32, quint32> ranges = {{
-    {ranges}
+// code point >> 8 => 1-based index in emojiBlocks or 0 if there are no emojis in the block
+static const quint8 emojiBlockIndex[] = {{
+    {block_index}
+}};
+
+// 256-bit masks of emoji code points
+static const quint32 emojiBlocks[][8] = {{
+    {blocks}
 }};
 
 // clang-format on
@@ -107,6 +115,32 @@ def generate_ranges():
     ranges.append((range_start, cur_code))
 
 
+def generate_table():
+    masks = {}
+    for r in ranges:
+        for code in range(r[0], r[1] + 1):
+            mask = masks.setdefault(code >> 8, [0] * 8)
+            mask[(code & 0xff) >> 5] |= 1 << (code & 31)
+    block_index.extend([0] * (max(masks) + 1))
+    for block, mask in sorted(masks.items()):
+        if mask not in blocks:
+            blocks.append(mask)
+        block_index[block] = blocks.index(mask) + 1
+
+
+def check_table():
+    # the same lookup as EmojiRegistry::isEmojiCodePoint() does
+    def in_table(code):
+        block = code >> 8
+        if block >= len(block_index) or not block_index[block]:
+            return False
+        return bool(blocks[block_index[block] - 1][(code & 0xff) >> 5] & (1 << (code & 31)))
+
+    for code in range(0x20000):
+        expected = any(r[0] <= code <= r[1] for r in ranges)
+        assert in_table(code) == expected, f"emoji table mismatch at U+{code:04X}"
+
+
 def generate_cpp_db():
     print(template_main.format(groups=",".join([
         template_group.format(name=group["name"], subgroups=",".join([
@@ -117,7 +151,9 @@ def generate_cpp_db():
             for sub in group["subgroups"]
         ]))
         for group in data
-    ]), ranges=",\n    ".join([f"{{{r[0]}, {r[1]}}}" for r in ranges])))
+    ]), block_index=",\n    ".join([", ".join([str(i) for i in block_index[n:n + 16]])
+                                       for n in range(0, len(block_index), 16)]),
+       blocks=",\n    ".join(["{" + ", ".join([f"0x{m:08x}" for m in mask]) + "}" for mask in blocks])))
 
 
 # https://unicode.org/Public/emoji/15.0/emoji-test.txt
@@ -126,4 +162,6 @@ with open("emoji-test.txt") as f:
     parse(f)
     cleanup_empty()
     generate_ranges()
+    generate_table()
+    check_table()
     generate_cpp_db()
@@ -235,7 +235,7 @@ void AlertIcon::stop() { d->stop(); }
 
 QIcon AlertIcon::icon() const { return d->real->icon(); }
 
-const Impix &AlertIcon::impix() const { return d->impix; }
+Impix AlertIcon::impix() const { return d->impix; }
 
 int AlertIcon::frameNumber() const
 {
@@ -637,7 +637,8 @@ QPixmap AvatarFactory::getAvatar(const Jid &_jid)
     }
 
     if (img.isNull()) {
-        auto vcard = VCardFactory::instance()->vcard(_jid);
+        // don't block painting on disk. vcardPhotoAvailable() will come if it's there
+        auto vcard = VCardFactory::instance()->cachedVCard(_jid);
         if (vcard.isNull() || vcard.photo().isNull()) {
             return QPixmap();
         }
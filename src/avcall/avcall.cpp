@@ -672,6 +672,29 @@ void AvCall::setIncomingVideo(PsiMedia::VideoWidget *widget) { d->rtp.setVideoOu
 
 QString AvCall::errorString() const { return d->errorString; }
 
+QString AvCall::statistics() const
+{
+    if (!d->avTransmit)
+        return QString();
+
+    QStringList lines;
+    auto        add = [&](const QString &name, JingleRtp::Type type) {
+        auto s = d->avTransmit->transport->stats(type);
+        if (!s.packetsIn && !s.packetsOut)
+            return;
+        lines << tr("%1: sent %2, received %3, dropped %4, jitter %5 ms, delay %6 ms")
+                     .arg(name)
+                     .arg(s.packetsOut)
+                     .arg(s.packetsIn)
+                     .arg(s.dropped)
+                     .arg(s.jitter / 1000.0, 0, 'f', 1)
+                     .arg(s.delay / 1000.0, 0, 'f', 1);
+    };
+    add(tr("Audio"), JingleRtp::Audio);
+    add(tr("Video"), JingleRtp::Video);
+    return lines.join('\n');
+}
+
 void AvCall::unlink() { d->unlink(); }
 
 //----------------------------------------------------------------------------
@@ -59,6 +59,9 @@ public:
 
     QString errorString() const;
 
+    // human-readable statistics of the active media streams
+    QString statistics() const;
+
     // if we use deleteLater() on a call, then it won't detach from the
     //   manager until the deletion resolves.  use unlink() to immediately
     //   detach, and then call deleteLater().
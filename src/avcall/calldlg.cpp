@@ -233,6 +233,7 @@ private slots:
     {
         call_duration = call_duration.addSecs(1);
         ui.lb_status->setText(tr("Call duration: %1").arg(call_duration.toString("mm:ss")));
+        ui.lb_status->setToolTip(sess->statistics());
     }
 };
 
@@ -26,10 +26,15 @@
 #include "jingle.h"
 #include "xmpp_client.h"
 
+#include <QElapsedTimer>
+#include <QVector>
 #include <QtCrypto>
 #include <cstdio>
 #include <cstdlib>
 
+// incoming packets not yet taken by the media layer. the oldest ones are dropped on overflow
+#define RTP_IN_QUEUE_SIZE 256
+
 // TODO: reject offers that don't contain at least one of audio or video
 // TODO: support candidate negotiations over the JingleRtpChannel thread
 //   boundary, so we can change candidates after the stream is active
@@ -236,12 +241,29 @@ class JingleRtpChannelPrivate : public QObject {
 public:
     JingleRtpChannel *q;
 
-    QMutex                      m;
-    XMPP::UdpPortReserver *     portReserver;
-    XMPP::Ice176 *              iceA;
-    XMPP::Ice176 *              iceV;
-    QTimer *                    rtpActivityTimer;
-    QList<JingleRtp::RtpPacket> in;
+    struct InPacket {
+        JingleRtp::RtpPacket packet;
+        qint64               received; // nsecs of clock
+    };
+
+    struct StreamStats {
+        JingleRtp::RtpStats stats;
+        qint64              lastArrival  = -1;
+        qint64              lastInterval = -1;
+    };
+
+    QMutex                 m;
+    XMPP::UdpPortReserver *portReserver;
+    XMPP::Ice176 *         iceA;
+    XMPP::Ice176 *         iceV;
+    QTimer *               rtpActivityTimer;
+    QVector<InPacket>      in; // preallocated ring
+    int                    inHead  = 0;
+    int                    inCount = 0;
+    QElapsedTimer          clock;
+    mutable QMutex         statsMutex;
+    StreamStats            audioStats;
+    StreamStats            videoStats;
 
     explicit JingleRtpChannelPrivate(JingleRtpChannel *_q);
     ~JingleRtpChannelPrivate() override;
@@ -249,6 +271,14 @@ public:
     void setIceObjects(XMPP::UdpPortReserver *_portReserver, XMPP::Ice176 *_iceA, XMPP::Ice176 *_iceV);
     void restartRtpActivityTimer();
 
+    void                 enqueue(JingleRtp::Type type, int portOffset, const QByteArray &value);
+    JingleRtp::RtpPacket dequeue();
+
+    inline StreamStats &streamStats(JingleRtp::Type type)
+    {
+        return type == JingleRtp::Audio ? audioStats : videoStats;
+    }
+
 private slots:
     void start();
     void ice_readyRead(int componentIndex);
@@ -1242,8 +1272,9 @@ JingleRtpChannel *JingleRtp::rtpChannel() { return d->rtpChannel; }
 // JingleRtpChannel
 //----------------------------------------------------------------------------
 JingleRtpChannelPrivate::JingleRtpChannelPrivate(JingleRtpChannel *_q) :
-    QObject(_q), q(_q), portReserver(nullptr), iceA(nullptr), iceV(nullptr)
+    QObject(_q), q(_q), portReserver(nullptr), iceA(nullptr), iceV(nullptr), in(RTP_IN_QUEUE_SIZE)
 {
+    clock.start();
     rtpActivityTimer = new QTimer(this);
     connect(rtpActivityTimer, SIGNAL(timeout()), SLOT(rtpActivity_timeout()));
 }
@@ -1351,27 +1382,68 @@ void JingleRtpChannelPrivate::ice_readyRead(int componentIndex)
         restartRtpActivityTimer();
 
     if (ice == iceA) {
-        while (iceA->hasPendingDatagrams(componentIndex)) {
-            JingleRtp::RtpPacket packet;
-            packet.type       = JingleRtp::Audio;
-            packet.portOffset = componentIndex;
-            packet.value      = iceA->readDatagram(componentIndex);
-            in += packet;
-        }
+        while (iceA->hasPendingDatagrams(componentIndex))
+            enqueue(JingleRtp::Audio, componentIndex, iceA->readDatagram(componentIndex));
     } else // iceV
     {
-        while (iceV->hasPendingDatagrams(componentIndex)) {
-            JingleRtp::RtpPacket packet;
-            packet.type       = JingleRtp::Video;
-            packet.portOffset = componentIndex;
-            packet.value      = iceV->readDatagram(componentIndex);
-            in += packet;
-        }
+        while (iceV->hasPendingDatagrams(componentIndex))
+            enqueue(JingleRtp::Video, componentIndex, iceV->readDatagram(componentIndex));
     }
 
     emit q->readyRead();
 }
 
+void JingleRtpChannelPrivate::enqueue(JingleRtp::Type type, int portOffset, const QByteArray &value)
+{
+    qint64       now = clock.nsecsElapsed();
+    StreamStats &ss  = streamStats(type);
+    {
+        QMutexLocker locker(&statsMutex);
+        ss.stats.packetsIn++;
+        if (inCount == in.size())
+            ss.stats.dropped++;
+        // RFC 3550-like estimator, just by arrival time as the clock rate of the payload is unknown here
+        if (ss.lastArrival != -1) {
+            qint64 interval = now - ss.lastArrival;
+            if (ss.lastInterval != -1) {
+                int d = int(qAbs(interval - ss.lastInterval) / 1000);
+                ss.stats.jitter += (d - ss.stats.jitter) / 16;
+            }
+            ss.lastInterval = interval;
+        }
+        ss.lastArrival = now;
+    }
+
+    if (inCount == in.size()) { // overflow. the newest data is more valuable
+        inHead = (inHead + 1) % in.size();
+        inCount--;
+    }
+    InPacket &slot         = in[(inHead + inCount) % in.size()];
+    slot.packet.type       = type;
+    slot.packet.portOffset = portOffset;
+    slot.packet.value      = value;
+    slot.received          = now;
+    inCount++;
+}
+
+JingleRtp::RtpPacket JingleRtpChannelPrivate::dequeue()
+{
+    InPacket &slot = in[inHead];
+    inHead         = (inHead + 1) % in.size();
+    inCount--;
+
+    JingleRtp::RtpPacket packet;
+    packet.type       = slot.packet.type;
+    packet.portOffset = slot.packet.portOffset;
+    packet.value.swap(slot.packet.value); // the slot doesn't keep a reference to the data
+
+    int          delay = int((clock.nsecsElapsed() - slot.received) / 1000);
+    QMutexLocker locker(&statsMutex);
+    auto &       stats = streamStats(packet.type).stats;
+    stats.delay += (delay - stats.delay) / 16;
+    return packet;
+}
+
 void JingleRtpChannelPrivate::ice_datagramsWritten(int componentIndex, int count)
 {
     Q_UNUSED(componentIndex);
@@ -1388,18 +1460,31 @@ JingleRtpChannel::JingleRtpChannel() { d = new JingleRtpChannelPrivate(this); }
 
 JingleRtpChannel::~JingleRtpChannel() { delete d; }
 
-bool JingleRtpChannel::packetsAvailable() const { return !d->in.isEmpty(); }
+bool JingleRtpChannel::packetsAvailable() const { return d->inCount > 0; }
 
-JingleRtp::RtpPacket JingleRtpChannel::read() { return d->in.takeFirst(); }
+JingleRtp::RtpPacket JingleRtpChannel::read() { return d->dequeue(); }
 
 void JingleRtpChannel::write(const JingleRtp::RtpPacket &packet)
 {
-    QMutexLocker locker(&d->m);
+    {
+        QMutexLocker locker(&d->m);
+
+        if (packet.type == JingleRtp::Audio && d->iceA)
+            d->iceA->writeDatagram(packet.portOffset, packet.value);
+        else if (packet.type == JingleRtp::Video && d->iceV)
+            d->iceV->writeDatagram(packet.portOffset, packet.value);
+        else
+            return;
+    }
 
-    if (packet.type == JingleRtp::Audio && d->iceA)
-        d->iceA->writeDatagram(packet.portOffset, packet.value);
-    else if (packet.type == JingleRtp::Video && d->iceV)
-        d->iceV->writeDatagram(packet.portOffset, packet.value);
+    QMutexLocker locker(&d->statsMutex);
+    d->streamStats(packet.type).stats.packetsOut++;
+}
+
+JingleRtp::RtpStats JingleRtpChannel::stats(JingleRtp::Type type) const
+{
+    QMutexLocker locker(&d->statsMutex);
+    return d->streamStats(type).stats;
 }
 
 //----------------------------------------------------------------------------
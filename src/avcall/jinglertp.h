@@ -45,6 +45,15 @@ public:
         QByteArray value;
     };
 
+    class RtpStats {
+    public:
+        quint64 packetsIn  = 0;
+        quint64 packetsOut = 0;
+        quint64 dropped    = 0; // incoming packets which didn't fit the queue
+        int     jitter     = 0; // smoothed variation of packets interarrival time, usec
+        int     delay      = 0; // smoothed time a packet waits in the incoming queue, usec
+    };
+
     ~JingleRtp() override;
 
     XMPP::Jid                   jid() const;
@@ -105,6 +114,9 @@ public:
     JingleRtp::RtpPacket read();
     void                 write(const JingleRtp::RtpPacket &packet);
 
+    // thread-safe
+    JingleRtp::RtpStats stats(JingleRtp::Type type) const;
+
 signals:
     void readyRead();
 
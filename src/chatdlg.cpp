@@ -106,11 +106,17 @@ ChatDlg::ChatDlg(const Jid &jid, PsiAccount *pa, TabManager *tabManager) :
 
     status_ = -1;
 
+    historyPending_   = false;
+    historyInclusive_ = true;
+    historySkip_      = 0;
     if (!pa->findGCContact(jid) || ((pa->edb()->features() & EDB::PrivateContacts) != 0)) {
-        historyState = false;
+        historyState   = false;
+        historyPaging_ = true;
         preloadHistory();
-    } else
-        historyState = true;
+    } else {
+        historyState   = true;
+        historyPaging_ = false;
+    }
 
     autoSelectContact_ = false;
     if (PsiOptions::instance()->getOption("options.ui.chat.default-jid-mode").toString() == "auto") {
@@ -149,6 +155,10 @@ void ChatDlg::init()
     chatView()->setMediaOpener(account()->fileSharingDeviceOpener());
 #endif
     chatView()->init();
+#ifndef WEBKIT
+    connect(chatView(), SIGNAL(historyRequested()), SLOT(requestHistoryPage()));
+    connect(chatView(), SIGNAL(scrollbackTrimmed(QDateTime)), SLOT(historyTrimmed(QDateTime)));
+#endif
 
     // seems its useless hack
     // connect(chatView(), SIGNAL(selectionChanged()), SLOT(logSelectionChanged())); //
@@ -427,14 +437,19 @@ void ChatDlg::preloadHistory()
             cnt = 100;
         EDBHandle *h = new EDBHandle(account()->edb());
         connect(h, SIGNAL(finished()), this, SLOT(getHistory()));
-        Jid j = jid();
-        if (!account()->findGCContact(j))
-            j = jid().bare();
         int start = account()->eventQueue()->count(jid(), false);
-        h->get(account()->id(), j, QDateTime(), EDB::Backward, start, cnt);
+        h->get(account()->id(), historyJid(), QDateTime(), EDB::Backward, start, cnt);
     }
 }
 
+Jid ChatDlg::historyJid() const
+{
+    Jid j = jid();
+    if (!account()->findGCContact(j))
+        j = jid().bare();
+    return j;
+}
+
 void ChatDlg::getHistory()
 {
     EDBHandle *h = qobject_cast<EDBHandle *>(sender());
@@ -455,6 +470,114 @@ void ChatDlg::getHistory()
     holdMessages(false);
 }
 
+// identifies a message among the ones of the same second. the stanza id is kept
+// in the history, so identical lines sent in one second are still told apart
+static QString historyKey(const Message &m, bool local)
+{
+    return QString(local ? QLatin1String(">") : QLatin1String("<")) + m.id() + QLatin1Char('\n') + m.body();
+}
+
+#ifndef WEBKIT
+/**
+ * Loads a page of messages older than the oldest one in the log.
+ * Called when the user scrolls to the top of the log.
+ *
+ * The history stores seconds only, so the page starts with the second of the
+ * oldest message again and the messages of it already in the log are skipped.
+ */
+void ChatDlg::requestHistoryPage()
+{
+    if (!historyPaging_ || historyPending_ || delayedMessages || !historyDate_.isValid())
+        return;
+
+    int cnt = PsiOptions::instance()->getOption("options.ui.chat.history.page-size").toInt();
+    if (cnt <= 0)
+        return;
+    if (cnt > 100) // the same limit as for preloaded history
+        cnt = 100;
+    historyPending_ = true;
+    EDBHandle *h    = new EDBHandle(account()->edb());
+    connect(h, SIGNAL(finished()), this, SLOT(getHistoryPage()));
+    QDateTime before = historyInclusive_ ? historyDate_.addSecs(1) : historyDate_;
+    h->setProperty("before", before);
+    h->get(account()->id(), historyJid(), before, EDB::Backward, historySkip_, cnt);
+}
+
+void ChatDlg::getHistoryPage()
+{
+    EDBHandle *h = qobject_cast<EDBHandle *>(sender());
+    if (!h)
+        return;
+
+    QDateTime before = historyInclusive_ ? historyDate_.addSecs(1) : historyDate_;
+    if (h->property("before").toDateTime() != before) {
+        // the log was trimmed meanwhile, so the page doesn't fit to it
+        delete h;
+        historyPending_ = false;
+        return;
+    }
+
+    const EDBResult &        r = h->result();
+    QList<MessageEvent::Ptr> page; // oldest first
+    for (int i = r.count() - 1; i >= 0; --i) {
+        PsiEvent::Ptr e = r.at(i)->event();
+        if (e->type() != PsiEvent::Message)
+            continue;
+        MessageEvent::Ptr me = e.staticCast<MessageEvent>();
+        if (e->timeStamp().toSecsSinceEpoch() == historyDate_.toSecsSinceEpoch()
+            && historyShown_.contains(historyKey(me->message(), me->originLocal())))
+            continue;
+        page.append(me);
+    }
+
+    bool repeat = false;
+    if (r.isEmpty()) {
+        historyPaging_ = false; // reached the beginning of the history
+    } else if (page.isEmpty()) {
+        // everything is in the log already. look further
+        historySkip_ += r.count();
+        repeat = true;
+    } else {
+        historyDate_      = r.last()->event()->timeStamp();
+        historyInclusive_ = true;
+        historySkip_      = 0;
+        historyShown_.clear(); // filled again by appendMessage()
+
+        bool oldHistoryState = historyState;
+        bool oldTrackBar     = trackBar_;
+        historyState         = true;
+        trackBar_            = false;
+        chatView()->beginPrepend();
+        for (const MessageEvent::Ptr &me : qAsConst(page))
+            appendMessage(me->message(), me->originLocal());
+        chatView()->endPrepend();
+        historyState = oldHistoryState;
+        trackBar_    = oldTrackBar;
+    }
+    delete h;
+    historyPending_ = false;
+    if (repeat)
+        requestHistoryPage();
+}
+
+/**
+ * The view dropped the oldest messages. It cuts between seconds, so paging
+ * continues right before the oldest message left.
+ */
+void ChatDlg::historyTrimmed(const QDateTime &oldest)
+{
+    if (!oldest.isValid())
+        return;
+
+    historyDate_      = oldest;
+    historyInclusive_ = false;
+    historySkip_      = 0;
+    historyShown_.clear();
+    // the beginning of the history isn't in the log anymore
+    historyPaging_ = !account()->findGCContact(jid()) || (account()->edb()->features() & EDB::PrivateContacts);
+}
+#endif
+
 void ChatDlg::ensureTabbedCorrectly()
 {
     TabbableWidget::ensureTabbedCorrectly();
@@ -829,6 +952,11 @@ void ChatDlg::appendMessage(const Message &m, bool local)
     if (trackBar_)
         doTrackBar();
 
+    if (!historyDate_.isValid())
+        historyDate_ = m.timeStamp();
+    if (m.timeStamp().toSecsSinceEpoch() == historyDate_.toSecsSinceEpoch())
+        historyShown_ += historyKey(m, local);
+
     // figure out the encryption state
     bool encChanged = false;
     bool encEnabled = false;
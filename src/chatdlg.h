@@ -26,10 +26,12 @@
 
 #include <QCloseEvent>
 #include <QContextMenuEvent>
+#include <QDateTime>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QKeyEvent>
 #include <QResizeEvent>
+#include <QSet>
 #include <QShowEvent>
 #include <QTextEdit>
 
@@ -146,6 +148,11 @@ private slots:
     void         initComposing();
     void         setComposing();
     void         getHistory();
+#ifndef WEBKIT
+    void requestHistoryPage();
+    void getHistoryPage();
+    void historyTrimmed(const QDateTime &oldest);
+#endif
 
 protected slots:
     void checkComposing();
@@ -157,6 +164,7 @@ protected:
     void         updateRealJid();
     void         resetComposing();
     void         doneSend();
+    Jid          historyJid() const;
     void         holdMessages(bool hold);
     void         displayMessage(const MessageView &mv);
     virtual void setLooks();
@@ -212,6 +220,12 @@ private:
     bool                isComposing_;
     bool                sendComposingEvents_;
     bool                historyState;
+    bool                historyPaging_;
+    bool                historyPending_;
+    QDateTime           historyDate_;      // timestamp of the oldest message in the log
+    bool                historyInclusive_; // the next page may repeat messages of historyDate_'s second
+    int                 historySkip_;      // items of that second known to be shown already
+    QSet<QString>       historyShown_;     // messages of historyDate_'s second in the log
     QString             eventId_;
     ChatState           contactChatState_;
     ChatState           lastChatState_;
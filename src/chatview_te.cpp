@@ -49,12 +49,29 @@ static const char *  informationalColorOpt = "options.ui.look.colors.messages.in
 static const QRegExp underlineFixRE("(<a href=\"addnick://psi/[^\"]*\"><span style=\")");
 static const QRegExp removeTagsRE("<[^>]*>");
 
+// the time of the message which ends in the block. used to find where the log begins after a trim
+class MessageBlockData : public QTextBlockUserData {
+public:
+    MessageBlockData(const QDateTime &time) : time(time) { }
+
+    QDateTime time;
+};
+
+static QDateTime blockTime(const QTextBlock &block)
+{
+    auto data = static_cast<MessageBlockData *>(block.userData());
+    return data ? data->time : QDateTime();
+}
+
 //----------------------------------------------------------------------------
 // ChatView
 //----------------------------------------------------------------------------
 ChatView::ChatView(QWidget *parent) :
-    PsiTextView(parent), isMuc_(false), isEncryptionEnabled_(false), oldTrackBarPosition(0), dialog_(nullptr)
+    PsiTextView(parent), isMuc_(false), isEncryptionEnabled_(false), prependPosition_(-1),
+    prependFromBottom_(0), dialog_(nullptr)
 {
+    scrollbackLimit_ = PsiOptions::instance()->getOption("options.ui.chat.scrollback-size").toInt();
+
     setWordWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
 
     setReadOnly(true);
@@ -72,6 +89,11 @@ ChatView::ChatView(QWidget *parent) :
     addAction(actQuote_);
     connect(actQuote_, &QAction::triggered, this, [this](bool) { emit quote(getPlainText()); });
     connect(this, &ChatView::selectionChanged, this, [this]() { actQuote_->setEnabled(textCursor().hasSelection()); });
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        // the user reached the top of the log. ask for older messages
+        if (value == verticalScrollBar()->minimum() && verticalScrollBar()->maximum() > 0 && prependPosition_ < 0)
+            emit historyRequested();
+    });
 
     addLogIconsResources();
 }
@@ -98,9 +120,82 @@ void ChatView::setSessionData(bool isMuc, bool isMucPrivate, const XMPP::Jid &ji
 void ChatView::clear()
 {
     PsiTextView::clear();
+    oldTrackBar_ = QTextCursor();
     addLogIconsResources();
 }
 
+/**
+ * Messages dispatched between beginPrepend() and endPrepend() are inserted
+ * at the top of the log in the order they come, keeping the visible part in place.
+ */
+void ChatView::beginPrepend()
+{
+    prependFromBottom_ = verticalScrollBar()->maximum() - verticalScrollBar()->value();
+
+    // separate the first message already in the log from the prepended ones
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.insertBlock();
+    prependPosition_ = 0;
+}
+
+void ChatView::endPrepend()
+{
+    prependPosition_ = -1;
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum() - prependFromBottom_);
+}
+
+/**
+ * Drops the oldest blocks when the log grows past "options.ui.chat.scrollback-size".
+ * While the user reads older messages the log may grow up to twice the limit.
+ * The cut is made between seconds, so the history can be paged in again exactly
+ * from the time reported by scrollbackTrimmed().
+ */
+void ChatView::trimScrollback()
+{
+    if (scrollbackLimit_ <= 0 || prependPosition_ >= 0)
+        return;
+
+    bool doScrollToBottom = atBottom();
+    int  excess           = document()->blockCount() - scrollbackLimit_;
+    if (excess <= 0 || (!doScrollToBottom && excess < scrollbackLimit_))
+        return;
+    excess += scrollbackLimit_ / 10; // so it's not done on each append
+
+    QScrollBar *bar        = verticalScrollBar();
+    int         fromBottom = bar->maximum() - bar->value();
+
+    // cut after the end of a message, and take the rest of its second too
+    QTextBlock keep = document()->begin();
+    QDateTime  oldest;
+    qint64     cutSecs = -1;
+    int        i       = 0;
+    for (QTextBlock block = keep; block.next().isValid(); block = block.next(), ++i) {
+        QDateTime time = blockTime(block);
+        if (!time.isValid())
+            continue;
+        if (i >= excess && time.toSecsSinceEpoch() != cutSecs) {
+            oldest = time;
+            break;
+        }
+        cutSecs = time.toSecsSinceEpoch();
+        keep    = block.next();
+    }
+    if (keep == document()->begin())
+        return;
+
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.setPosition(keep.position(), QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+
+    if (doScrollToBottom)
+        scrollToBottom();
+    else
+        bar->setValue(bar->maximum() - fromBottom);
+    emit scrollbackTrimmed(oldest);
+}
+
 void ChatView::contextMenuEvent(QContextMenuEvent *e)
 {
     const QUrl anc = QUrl::fromEncoded(anchorAt(e->pos()).toLatin1());
@@ -279,7 +374,10 @@ void ChatView::appendText(const QString &text)
 void ChatView::dispatchMessage(const MessageView &mv)
 {
     const QString &replaceId = mv.replaceId();
-    if ((mv.type() == MessageView::Message || mv.type() == MessageView::Subject)
+    bool           prepend   = prependPosition_ >= 0;
+    if (prepend && mv.type() != MessageView::Message)
+        return; // only messages are paged in from the history
+    if ((mv.type() == MessageView::Message || mv.type() == MessageView::Subject) && !prepend
         && ChatViewCommon::updateLastMsgTime(mv.dateTime()) && replaceId.isEmpty()) {
         QString color = ColorOpt::instance()->color(informationalColorOpt).name();
         appendText(
@@ -291,7 +389,7 @@ void ChatView::dispatchMessage(const MessageView &mv)
     case MessageView::Message: {
         int         scrollPos      = verticalScrollBar()->value();
         bool        doScrollBottom = atBottom();
-        bool        isReplace      = !replaceId.isEmpty();
+        bool        isReplace      = !replaceId.isEmpty() && !prepend;
         QTextCursor cursor         = textCursor(), replaceCursor;
         auto        sel            = PsiRichText::saveSelection(this, cursor);
         cursor.clearSelection();
@@ -314,6 +412,8 @@ void ChatView::dispatchMessage(const MessageView &mv)
                     QTextCursor::KeepAnchor); // returne cursor is a selection of marker. so we need anchor
             }
             // qDebug("text to remove: %s", qPrintable(cursor.selectedText()));
+        } else if (prepend) {
+            cursor.setPosition(prependPosition_);
         } else {
             cursor.movePosition(QTextCursor::End); // no luck with replace, then insert into the end of doc
         }
@@ -325,6 +425,8 @@ void ChatView::dispatchMessage(const MessageView &mv)
             renderMessage(mv, cursor);
         }
         cursor = textCursor(); // take it again. since render function do not modify it
+        if (!cursor.block().userData())
+            cursor.block().setUserData(new MessageBlockData(mv.dateTime()));
         if (isReplace) {
             QTextImageFormat imageFormat;
             imageFormat.setName("icon:log_icon_corrected");
@@ -336,6 +438,8 @@ void ChatView::dispatchMessage(const MessageView &mv)
             // qDebug("end marker at %d", cursor.position());
             PsiRichText::insertMarker(cursor, QString()); // end marker
         }
+        if (prepend)
+            prependPosition_ = cursor.position();
         cursor.movePosition(QTextCursor::End); // ensure everything else is inserted into the end
         PsiRichText::restoreSelection(this, cursor, sel);
         setTextCursor(cursor);
@@ -363,6 +467,8 @@ void ChatView::dispatchMessage(const MessageView &mv)
     default: // System/Status
         renderSysMessage(mv);
     }
+
+    trimScrollback();
 }
 
 QString ChatView::replaceMarker(const MessageView &mv) const
@@ -584,17 +690,17 @@ void ChatView::doTrackBar()
     PsiRichText::Selection selection = PsiRichText::saveSelection(this, cursor);
 
     // removeTrackBar(cursor);
-    if (oldTrackBarPosition) {
-        cursor.setPosition(oldTrackBarPosition, QTextCursor::KeepAnchor);
-        QTextBlockFormat blockFormat = cursor.blockFormat();
+    if (!oldTrackBar_.isNull()) {
+        QTextBlockFormat blockFormat = oldTrackBar_.blockFormat();
         blockFormat.clearProperty(QTextFormat::BlockTrailingHorizontalRulerWidth);
-        cursor.clearSelection();
-        cursor.setBlockFormat(blockFormat);
+        oldTrackBar_.setBlockFormat(blockFormat);
     }
 
     // addTrackBar(cursor);
     cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-    oldTrackBarPosition          = cursor.position();
+    oldTrackBar_ = cursor;
+    oldTrackBar_.clearSelection();
+    oldTrackBar_.setKeepPositionOnInsert(true); // stay in this block when messages are appended
     QTextBlockFormat blockFormat = cursor.blockFormat();
     blockFormat.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth, QVariant(true));
     cursor.clearSelection();
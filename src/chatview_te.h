@@ -27,6 +27,7 @@
 #include <QContextMenuEvent>
 #include <QDateTime>
 #include <QPointer>
+#include <QTextCursor>
 #include <QWidget>
 
 class ChatEdit;
@@ -69,6 +70,9 @@ public:
     QWidget * realTextWidget();
 
     void updateAvatar(const XMPP::Jid &jid, ChatViewCommon::UserType utype);
+
+    void beginPrepend();
+    void endPrepend();
 public slots:
     void scrollUp();
     void scrollDown();
@@ -90,6 +94,7 @@ protected:
     void    renderSubject(const MessageView &);
     void    renderMucSubject(const MessageView &);
     void    renderUrls(const MessageView &);
+    void    trimScrollback();
 
 protected slots:
     void autoCopy();
@@ -101,13 +106,18 @@ signals:
     void showNM(const QString &);
     void quote(const QString &text);
     void nickInsertClick(const QString &nick);
+    void historyRequested();
+    void scrollbackTrimmed(const QDateTime &oldest);
 
 private:
     bool              isMuc_;
     bool              isMucPrivate_;
     bool              isEncryptionEnabled_;
     bool              useMessageIcons_;
-    int               oldTrackBarPosition;
+    QTextCursor       oldTrackBar_; // follows the text when the log is trimmed or prepended
+    int               scrollbackLimit_;
+    int               prependPosition_;
+    int               prependFromBottom_;
     XMPP::Jid         jid_;
     QString           name_;
     QPointer<QWidget> dialog_;
@@ -23,6 +23,7 @@
 #include "avatars.h"
 #include "chatviewtheme.h"
 #include "chatviewthemeprovider.h"
+#include "chatviewthemeprovider_priv.h"
 #include "desktoputil.h"
 #include "filesharingmanager.h"
 #include "jsutil.h"
@@ -44,6 +45,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -53,6 +55,7 @@
 #include <QMetaProperty>
 #include <QNetworkReply>
 #include <QPalette>
+#include <QTimer>
 #include <QWidget>
 #ifdef WEBENGINE
 #if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
@@ -78,7 +81,9 @@ public:
     QAction                  *quoteAction = nullptr;
     ChatViewJSObject         *jsObject    = nullptr;
     QList<QVariantMap>        jsBuffer_;
-    bool                      sessionReady_ = false;
+    bool                      sessionReady_      = false;
+    bool                      firstMessageShown_ = false;
+    QElapsedTimer             openTimer; // time to the first message
     QPointer<QWidget>         dialog_;
     bool                      isMuc_               = false;
     bool                      isMucPrivate_        = false;
@@ -379,15 +384,103 @@ protected:
 
 #endif
 
+#ifdef WEBENGINE
+//----------------------------------------------------------------------------
+// ChatViewPagePool
+//----------------------------------------------------------------------------
+
+#define PAGE_POOL_MAX_SIZE 3
+#define PAGE_POOL_USAGE_WINDOW (10 * 60 * 1000) // ms
+#define PAGE_POOL_REFILL_DELAY 1000             // ms
+
+/**
+ * Keeps a few pages with a started renderer ready for new chat views.
+ * The number of pages follows the number of chats opened recently.
+ * Pages don't depend on the theme until a session is applied to them,
+ * so the pool is shared by all themes. The pool goes away with PsiCon,
+ * before the web engine profile is destroyed.
+ */
+class ChatViewPagePool : public QObject {
+public:
+    static ChatViewPagePool *instance()
+    {
+        static QPointer<ChatViewPagePool> pool;
+        if (!pool) {
+            pool = new ChatViewPagePool(ChatViewCon::isReady() ? static_cast<QObject *>(ChatViewCon::instance())
+                                                               : static_cast<QObject *>(qApp));
+        }
+        return pool;
+    }
+
+    ChatViewPage *take(QObject *parent)
+    {
+        usage_.append(clock_.elapsed());
+        refillTimer_->start();
+
+        ChatViewPage *page = pages_.isEmpty() ? new ChatViewPage(parent) : pages_.takeLast();
+        page->setParent(parent);
+        return page;
+    }
+
+    void recycle(ChatViewPage *page)
+    {
+        if (pages_.size() >= targetSize()) {
+            page->deleteLater();
+            return;
+        }
+        page->setParent(this);
+        page->setWebChannel(nullptr);
+        page->setBackgroundColor(Qt::white);
+        page->setUrl(QUrl(QLatin1String("about:blank"))); // drop the previous chat
+        pages_.append(page);
+    }
+
+private:
+    ChatViewPagePool(QObject *parent) : QObject(parent)
+    {
+        clock_.start();
+        refillTimer_ = new QTimer(this);
+        refillTimer_->setSingleShot(true);
+        refillTimer_->setInterval(PAGE_POOL_REFILL_DELAY); // not while the chat is being opened
+        connect(refillTimer_, &QTimer::timeout, this, [this]() {
+            while (pages_.size() < targetSize()) {
+                auto page = new ChatViewPage(this);
+                page->setUrl(QUrl(QLatin1String("about:blank"))); // starts the renderer
+                pages_.append(page);
+            }
+        });
+    }
+
+    int targetSize()
+    {
+        qint64 since = clock_.elapsed() - PAGE_POOL_USAGE_WINDOW;
+        while (!usage_.isEmpty() && usage_.first() < since) {
+            usage_.removeFirst();
+        }
+        return qBound(1, usage_.size(), PAGE_POOL_MAX_SIZE);
+    }
+
+    QList<ChatViewPage *> pages_;
+    QList<qint64>         usage_; // when pages were taken
+    QElapsedTimer         clock_;
+    QTimer *              refillTimer_;
+};
+#endif
+
 //----------------------------------------------------------------------------
 // ChatView
 //----------------------------------------------------------------------------
 ChatView::ChatView(QWidget *parent) : QFrame(parent), d(new ChatViewPrivate)
 {
+    d->openTimer.start();
     d->jsObject = new ChatViewJSObject(this); /* It's a session bridge between html and c++ part */
     d->webView  = new WebView(this);
     d->webView->setFocusPolicy(Qt::NoFocus);
+#ifdef WEBENGINE
+    d->webView->setPage(ChatViewPagePool::instance()->take(d->webView));
+#else
     d->webView->setPage(new ChatViewPage(d->webView));
+#endif
 
     d->quoteAction = new QAction(tr("Quote"), this);
     d->quoteAction->setShortcut(QKeySequence(tr("Ctrl+S")));
@@ -427,6 +520,14 @@ ChatView::ChatView(QWidget *parent) : QFrame(parent), d(new ChatViewPrivate)
 
 ChatView::~ChatView()
 {
+#ifdef WEBENGINE
+    auto page = static_cast<ChatViewPage *>(d->webView->page());
+    if (page->parent() == d->webView) {
+        page->setParent(nullptr); // the view would delete it on setPage()
+        d->webView->setPage(nullptr);
+        ChatViewPagePool::instance()->recycle(page);
+    }
+#endif
 #if defined(WEBENGINE) && QT_VERSION < QT_VERSION_CHECK(5, 12, 3)
     // next two lines is a workaround to some Qt(?) bug very similar to
     // QTBUG-48014 and bunch of others (deletes QWidget twice).
@@ -551,6 +652,10 @@ void ChatView::checkJsBuffer()
 {
     if (d->sessionReady_) {
         while (!d->jsBuffer_.isEmpty()) {
+            if (!d->firstMessageShown_ && d->jsBuffer_.first().value("type").toString() == QLatin1String("message")) {
+                d->firstMessageShown_ = true;
+                qDebug("ChatView: first message is shown in %lld ms", d->openTimer.elapsed());
+            }
             emit d->jsObject->newMessage(d->jsBuffer_.takeFirst());
         }
     }
@@ -558,7 +663,7 @@ void ChatView::checkJsBuffer()
 
 void ChatView::sessionInited()
 {
-    qDebug("Session is initialized");
+    qDebug("Session is initialized in %lld ms", d->openTimer.elapsed());
     d->sessionReady_ = true;
     checkJsBuffer();
 }
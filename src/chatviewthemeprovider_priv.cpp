@@ -31,6 +31,8 @@
 #endif
 
 #include <QBuffer>
+#include <QCryptographicHash>
+#include <QFileInfo>
 #include <QPointer>
 #include <QUrlQuery>
 #ifdef WEBENGINE
@@ -42,6 +44,13 @@
 static QPointer<ChatViewCon> cvCon;
 
 #ifdef WEBENGINE
+#define RESPONSE_CACHE_SIZE (4 * 1024 * 1024) // bytes of cached response bodies
+#define AVATAR_CACHE_CONTROL "public, max-age=31536000, immutable"
+
+static QByteArray contentTag(const QByteArray &data)
+{
+    return '"' + QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() + '"';
+}
 
 ChatViewUrlRequestInterceptor::ChatViewUrlRequestInterceptor(QObject *parent) : QWebEngineUrlRequestInterceptor(parent)
 {
@@ -69,72 +78,120 @@ void ChatViewUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo &i
 ChatViewCon::ChatViewCon(PsiCon *pc) : QObject(pc), pc(pc)
 {
 #ifdef WEBENGINE
+    responseCache.setMaxCost(RESPONSE_CACHE_SIZE);
+
     // handler reading data from themes directory
     WebServer::Handler themesDirHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
+        = [this](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
         QString fn = req->url().path().mid(sizeof("/psi/themes"));
         fn.replace("..", ""); // a little security
         fn = PsiThemeProvider::themePath(fn);
 
-        if (!fn.isEmpty()) {
-            QFile f(fn);
-            if (f.open(QIODevice::ReadOnly)) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
-                if (fn.endsWith(QLatin1String(".js"))) {
-                    res->headers().insert("Content-Type", "application/javascript;charset=utf-8");
-                }
-                if (fn.endsWith(QLatin1String(".css"))) {
-                    res->headers().insert("Content-Type", "text/css;charset=utf-8");
-                }
-                res->end(f.readAll());
-                f.close();
-                return true;
-            }
+        if (fn.isEmpty()) {
+            return false;
         }
-        return false;
+        QFileInfo       fi(fn);
+        QString         key = QLatin1String("theme:") + fn;
+        CachedResponse *cr  = responseCache.object(key);
+        if (cr && cr->modified == fi.lastModified()) {
+            sendCached(req, res, cr, false); // themes may be edited on disk
+            return true;
+        }
+
+        QFile f(fn);
+        if (!f.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        CachedResponse entry;
+        entry.body     = f.readAll();
+        entry.etag     = contentTag(entry.body);
+        entry.modified = fi.lastModified();
+        if (fn.endsWith(QLatin1String(".js"))) {
+            entry.contentType = "application/javascript;charset=utf-8";
+        }
+        if (fn.endsWith(QLatin1String(".css"))) {
+            entry.contentType = "text/css;charset=utf-8";
+        }
+        sendCached(req, res, &entry, false);
+        responseCache.insert(key, new CachedResponse(entry), entry.body.size());
+        return true;
     };
 
-    WebServer::Handler iconsHandler = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
+    WebServer::Handler iconsHandler
+        = [this](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
         QString name = req->url().path().mid(sizeof("/psi/icon"));
         auto    icon = IconsetFactory::iconPtr(name);
 
         if (icon) {
-            auto ba = icon->raw();
-            res->addHeader("Content-Type", icon->mimeType().toLatin1());
-            res->addHeader("Content-Length", QByteArray::number(ba.size()));
+            // the icon is already in memory. only its tag is cached and it's
+            // recalculated when another iconset provides the icon
+            auto            ba  = icon->raw();
+            QString         key = QLatin1String("icon:") + name;
+            CachedResponse *cr  = responseCache.object(key);
+            if (!cr || cr->body.constData() != ba.constData()) {
+                cr              = new CachedResponse;
+                cr->body        = ba;
+                cr->etag        = contentTag(ba);
+                cr->contentType = icon->mimeType().toLatin1();
+                responseCache.insert(key, cr, 1); // the body isn't a copy
+            }
             if (ba.size() > 1 && std::uint8_t(ba.at(0)) == 0x1f && std::uint8_t(ba.at(1)) == 0x8b) {
                 res->addHeader("Content-Encoding", "gzip");
             }
-            res->setStatusCode(qhttp::ESTATUS_OK);
-            res->end(ba);
+            sendCached(req, res, cr, false);
             return true;
         }
         return false;
     };
 
     WebServer::Handler avatarsHandler
-        = [&](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
-        QString    hash = req->url().path().mid(sizeof("/psi/avatar")); // no / because of null pointer
-        QByteArray ba;
+        = [this](qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) -> bool {
+        QString hash = req->url().path().mid(sizeof("/psi/avatar")); // no / because of null pointer
         if (hash == QLatin1String("default.png")) {
-            QPixmap p;
-            QBuffer buffer(&ba);
-            buffer.open(QIODevice::WriteOnly);
-            p = IconsetFactory::icon("psi/default_avatar").pixmap();
-            if (p.save(&buffer, "PNG")) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
-                res->headers().insert("Content-Type", "image/png");
-                res->end(ba);
+            // the png is made again when another iconset provides the icon
+            static const QString key    = QLatin1String("avatar:default");
+            auto                 icon   = IconsetFactory::iconPtr(QLatin1String("psi/default_avatar"));
+            const void *         source = icon ? icon->raw().constData() : nullptr;
+            CachedResponse *     cr     = responseCache.object(key);
+            if (cr && cr->source == source) {
+                sendCached(req, res, cr, false);
                 return true;
             }
-        } else {
-            AvatarFactory::AvatarData ad = AvatarFactory::avatarDataByHash(QByteArray::fromHex(hash.toLatin1()));
-            if (!ad.data.isEmpty()) {
-                res->setStatusCode(qhttp::ESTATUS_OK);
-                res->headers().insert("Content-Type", ad.metaType.toLatin1());
-                res->end(ad.data);
-                return true;
+
+            CachedResponse entry;
+            QBuffer        buffer(&entry.body);
+            buffer.open(QIODevice::WriteOnly);
+            QPixmap p = icon ? icon->pixmap() : QPixmap();
+            if (!p.save(&buffer, "PNG")) {
+                return false;
             }
+            buffer.close();
+            entry.etag        = contentTag(entry.body);
+            entry.contentType = "image/png";
+            entry.source      = source;
+            sendCached(req, res, &entry, false);
+            responseCache.insert(key, new CachedResponse(entry), entry.body.size());
+            return true;
+        }
+
+        // avatar urls are addressed by hash of their content, so the browser
+        // doesn't have to ask again once it has the avatar
+        QByteArray etag = '"' + hash.toLatin1() + '"';
+        if (req->headers().value("if-none-match") == etag) {
+            res->addHeader("ETag", etag);
+            res->addHeader("Cache-Control", AVATAR_CACHE_CONTROL);
+            res->setStatusCode(qhttp::ESTATUS_NOT_MODIFIED);
+            res->end();
+            return true;
+        }
+        AvatarFactory::AvatarData ad = AvatarFactory::avatarDataByHash(QByteArray::fromHex(hash.toLatin1()));
+        if (!ad.data.isEmpty()) {
+            CachedResponse cr;
+            cr.body        = ad.data;
+            cr.etag        = etag;
+            cr.contentType = ad.metaType.toLatin1();
+            sendCached(req, res, &cr, true);
+            return true;
         }
 
         return false;
@@ -353,4 +410,26 @@ QString ChatViewCon::registerSessionHandler(const WebServer::Handler &handler)
 void ChatViewCon::unregisterSessionHandler(const QString &path) { sessionHandlers.remove(path); }
 
 QUrl ChatViewCon::serverUrl() const { return pc->webServer()->serverUrl(); }
+
+/**
+ * Sends \a cr to the browser or just "304 Not Modified" if the browser has the same
+ * version in its cache. Not \a immutable responses are revalidated on each use.
+ */
+void ChatViewCon::sendCached(qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res,
+                             const CachedResponse *cr, bool immutable)
+{
+    res->addHeader("ETag", cr->etag);
+    res->addHeader("Cache-Control", immutable ? AVATAR_CACHE_CONTROL : "no-cache");
+    if (req->headers().value("if-none-match") == cr->etag) {
+        res->setStatusCode(qhttp::ESTATUS_NOT_MODIFIED);
+        res->end();
+        return;
+    }
+    if (!cr->contentType.isEmpty()) {
+        res->addHeader("Content-Type", cr->contentType);
+    }
+    res->addHeader("Content-Length", QByteArray::number(cr->body.size()));
+    res->setStatusCode(qhttp::ESTATUS_OK);
+    res->end(cr->body);
+}
 #endif
@@ -22,6 +22,8 @@
 
 #ifdef WEBENGINE
 #include "webserver.h"
+#include <QCache>
+#include <QDateTime>
 #include <QWebEngineUrlRequestInterceptor>
 #else
 #include <QObject> // at least
@@ -45,8 +47,20 @@ class ChatViewCon : public QObject {
 
     PsiCon *pc;
 #ifdef WEBENGINE
+    struct CachedResponse {
+        QByteArray  body;
+        QByteArray  etag;
+        QByteArray  contentType;
+        QDateTime   modified;         // of a file in themes directory
+        const void *source = nullptr; // icon data the body was made from
+    };
+
     QMap<QString, WebServer::Handler> sessionHandlers;
     int                               handlerSeed = 0;
+    QCache<QString, CachedResponse>   responseCache; // encoded bodies shared by all chat views
+
+    void sendCached(qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res, const CachedResponse *cr,
+                    bool immutable);
 #endif
     ChatViewCon(PsiCon *pc);
 
@@ -200,8 +200,10 @@ void ContactListModel::Private::addOperation(PsiContact *contact, ContactListMod
 
     if (commitTimerStartTime.secsTo(QDateTime::currentDateTime()) > MAX_COMMIT_DELAY)
         commit();
-    else
-        commitTimer->start();
+    else if (!bulkUpdates)
+        commitTimer->start(COMMIT_INTERVAL);
+    else if (!commitTimer->isActive())
+        commitTimer->start(MAX_COMMIT_DELAY * 1000); // in case the bulk update is never finished
 }
 
 int ContactListModel::Private::simplifiedOperationList(int operations) const
@@ -234,6 +236,7 @@ void ContactListModel::Private::commit()
     SLOW_TIMER(100);
 
     commitTimerStartTime = QDateTime();
+    bulkUpdates          = 0; // here during a bulk update only if it took over MAX_COMMIT_DELAY
 
     commitTimer->stop();
     if (operationQueue.isEmpty())
@@ -300,6 +303,23 @@ void ContactListModel::Private::clear()
     q->endResetModel();
 }
 
+/**
+ * Operations queued until the matching endBulkUpdate() are committed at once
+ * instead of every COMMIT_INTERVAL, e.g. for a slice of presences.
+ */
+void ContactListModel::Private::beginBulkUpdate()
+{
+    ++bulkUpdates;
+    if (commitTimer->isActive())
+        commitTimer->start(MAX_COMMIT_DELAY * 1000);
+}
+
+void ContactListModel::Private::endBulkUpdate()
+{
+    if (bulkUpdates && !--bulkUpdates)
+        commit();
+}
+
 void ContactListModel::Private::addContact(PsiContact *contact)
 {
     Q_ASSERT(!monitoredContacts.contains(contact));
@@ -452,6 +472,8 @@ ContactListModel::ContactListModel(PsiContactList *contactList, QObject *parent)
     connect(d->contactList, SIGNAL(showSelfChanged(bool)), SIGNAL(showSelfChanged()));
     connect(d->contactList, SIGNAL(showAgentsChanged(bool)), SIGNAL(showTransportsChanged()));
     connect(d->contactList, SIGNAL(rosterRequestFinished()), SLOT(rosterRequestFinished()));
+    connect(d->contactList, SIGNAL(beginBulkContactUpdate()), d, SLOT(beginBulkUpdate()));
+    connect(d->contactList, SIGNAL(endBulkContactUpdate()), d, SLOT(endBulkUpdate()));
     connect(d->contactList, SIGNAL(contactSortStyleChanged(QString)), SIGNAL(contactSortStyleChanged()));
 }
 
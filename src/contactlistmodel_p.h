@@ -35,6 +35,8 @@ public:
 public slots:
     void commit();
     void clear();
+    void beginBulkUpdate();
+    void endBulkUpdate();
     void addContact(PsiContact *contact);
     void removeContact(PsiContact *contact);
     void contactUpdated();
@@ -54,6 +56,7 @@ public:
     PsiContactList *                                contactList;
     QTimer *                                        commitTimer;
     QDateTime                                       commitTimerStartTime;
+    int                                             bulkUpdates = 0; // nesting level of bulk contact updates
     QMultiHash<PsiContact *, QPersistentModelIndex> monitoredContacts; // always keeps all the contacts
     QHash<PsiContact *, int>                        operationQueue;
     QStringList                                     collapsed;
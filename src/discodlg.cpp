@@ -44,9 +44,11 @@
 #include <QMenu>
 #include <QMessageBox>
 #include <QPainter>
+#include <QPointer>
 #include <QPushButton>
 #include <QScrollBar>
 #include <QSignalMapper>
+#include <QTimer>
 #include <QToolBar>
 #include <QToolButton>
 #include <QTreeWidget>
@@ -55,6 +57,9 @@
 
 #define MoreItemsType QTreeWidgetItem::UserType
 
+// how many disco#info requests for automatically queried items may run at once
+#define DISCO_INFO_CONCURRENCY 4
+
 PsiIcon category2icon(PsiAccount *acc, const Jid &jid, const QString &category, const QString &type,
                       int status = STATUS_ONLINE)
 {
@@ -160,15 +165,39 @@ public:
 
 signals:
     void itemUpdated(QTreeWidgetItem *);
+    void itemsChanged();
 
 private:
     friend class DiscoListItem;
 };
 
+// Sends automatic disco#info requests for the items the user can see, a few at a time
+class DiscoInfoQueue : public QObject {
+    Q_OBJECT
+public:
+    DiscoInfoQueue(QObject *parent) : QObject(parent) { }
+
+    void setPending(const QList<DiscoListItem *> &items);
+    void clear() { pending_.clear(); }
+
+    // disco#info results of already queried items, by DiscoListItem::hash()
+    QHash<QString, DiscoItem> cache;
+
+private slots:
+    void taskDestroyed();
+
+private:
+    void startNext();
+
+    QList<QPointer<DiscoListItem>> pending_;
+    int                            running_ = 0;
+};
+
 struct DiscoData {
     PsiAccount *    pa;
     TaskList *      tasks;
     DiscoConnector *d;
+    DiscoInfoQueue *infoQueue;
 };
 
 //----------------------------------------------------------------------------
@@ -237,6 +266,7 @@ public:
 
     void             setExpanded(bool expand);
     const DiscoItem &item() const;
+    bool             infoPending() const { return autoInfo && !infoRequested; }
 
     void itemSelected();
 
@@ -256,11 +286,13 @@ private:
     bool                 alreadyItems, alreadyInfo;
     bool                 autoItems; // used in updateItemsFinished
     bool                 autoInfo;
+    bool                 infoRequested;
     QString              errorInfo;
     DiscoExtraItem *     moreItem;
     SubsetsClientManager subsets;
 
     void    copyItem(const DiscoItem &);
+    Task *  requestInfo();
     void    updateInfo(const DiscoItem &);
     void    updateItemsFinished(const DiscoList &);
     void    autoItemsChildren() const; // automatically call disco#items for children :-)
@@ -276,6 +308,8 @@ private:
     bool      autoInfoEnabled() const;
     int       itemsPerPage() const;
     DiscoDlg *dlg() const;
+
+    friend class DiscoInfoQueue;
 };
 
 DiscoListItem::DiscoListItem(DiscoItem it, DiscoData *_d, QTreeWidget *parent) : DiscoBaseItem(parent)
@@ -301,17 +335,25 @@ void DiscoListItem::init(DiscoItem _item, DiscoData *_d)
     copyItem(_item);
 
     alreadyItems = alreadyInfo = false;
+    infoRequested              = false;
+    moreItem                   = nullptr;
 
     if (!autoItemsEnabled())
         setChildIndicatorPolicy(ShowIndicator);
 
+    // children are queried by DiscoInfoQueue once they get visible
     autoInfo = false;
-    if (autoInfoEnabled() || isRoot) {
+    if (isRoot) {
         updateInfo();
-        if (!isRoot)
+    } else if (autoInfoEnabled()) {
+        auto it = d->infoQueue->cache.constFind(hash());
+        if (it != d->infoQueue->cache.constEnd()) {
+            updateInfo(it.value());
+            alreadyInfo = true;
+        } else {
             autoInfo = true;
+        }
     }
-    moreItem = nullptr;
 }
 
 void DiscoListItem::copyItem(const DiscoItem &it)
@@ -537,6 +579,8 @@ void DiscoListItem::updateItemsFinished(const DiscoList &list)
         setHidden(false);
 
     treeWidget()->setUpdatesEnabled(true);
+
+    emit d->d->itemsChanged();
 }
 
 void DiscoListItem::autoItemsChildren() const
@@ -552,8 +596,12 @@ void DiscoListItem::autoItemsChildren() const
     }
 }
 
-void DiscoListItem::updateInfo()
+void DiscoListItem::updateInfo() { requestInfo(); }
+
+Task *DiscoListItem::requestInfo()
 {
+    infoRequested = true;
+
     JT_DiscoInfo *jt = new JT_DiscoInfo(d->pa->client()->rootTask());
     jt->setAllowCache(
         false); // Workaround for a bug https://github.com/hanzz/spectrum2/issues/205 (invalid caps from transport)
@@ -561,6 +609,7 @@ void DiscoListItem::updateInfo()
     jt->get(di.jid(), di.node());
     jt->go(true);
     d->tasks->append(jt);
+    return jt;
 }
 
 void DiscoListItem::discoInfoFinished()
@@ -568,6 +617,7 @@ void DiscoListItem::discoInfoFinished()
     JT_DiscoInfo *jt = static_cast<JT_DiscoInfo *>(sender());
 
     if (jt->success()) {
+        d->infoQueue->cache.insert(hash(), jt->item());
         updateInfo(jt->item());
     } else {
         QString error_str  = jt->statusString();
@@ -640,6 +690,43 @@ void DiscoExtraItem::init(const QString &text)
     setFont(0, f);
 }
 
+//----------------------------------------------------------------------------
+// DiscoInfoQueue
+//----------------------------------------------------------------------------
+
+/**
+ * Replaces the items waiting for disco#info. Requests which were already
+ * sent are not affected.
+ */
+void DiscoInfoQueue::setPending(const QList<DiscoListItem *> &items)
+{
+    pending_.clear();
+    for (DiscoListItem *item : items) {
+        pending_.append(item);
+    }
+    startNext();
+}
+
+void DiscoInfoQueue::startNext()
+{
+    while (running_ < DISCO_INFO_CONCURRENCY && !pending_.isEmpty()) {
+        DiscoListItem *item = pending_.takeFirst();
+        if (!item || !item->infoPending())
+            continue;
+
+        // tasks delete themselves when finished or when the account disconnects
+        Task *jt = item->requestInfo();
+        connect(jt, &QObject::destroyed, this, &DiscoInfoQueue::taskDestroyed);
+        ++running_;
+    }
+}
+
+void DiscoInfoQueue::taskDestroyed()
+{
+    --running_;
+    startNext();
+}
+
 //----------------------------------------------------------------------------
 // DiscoList
 //----------------------------------------------------------------------------
@@ -649,11 +736,19 @@ class DiscoListView : public QTreeWidget {
 
     DiscoDlg *dlg;
 
+    DiscoInfoQueue *infoQueue;
+    QTimer *        infoTimer;
+    QString         lastFilter;
+
 public:
-    DiscoListView(DiscoDlg *parent);
+    DiscoListView(DiscoDlg *parent, DiscoInfoQueue *queue);
 
 public slots:
     void updateItemsVisibility(const QString &filter);
+    void scheduleInfoUpdate();
+
+private slots:
+    void requestVisibleInfo();
 
 protected:
     bool maybeTip(const QPoint &);
@@ -663,9 +758,17 @@ protected:
     void resizeEvent(QResizeEvent *);
 };
 
-DiscoListView::DiscoListView(DiscoDlg *parent) : QTreeWidget(parent)
+DiscoListView::DiscoListView(DiscoDlg *parent, DiscoInfoQueue *queue) : QTreeWidget(parent)
 {
-    dlg = parent;
+    dlg       = parent;
+    infoQueue = queue;
+    infoTimer = new QTimer(this);
+    infoTimer->setSingleShot(true);
+    infoTimer->setInterval(100);
+    connect(infoTimer, &QTimer::timeout, this, &DiscoListView::requestVisibleInfo);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &DiscoListView::scheduleInfoUpdate);
+    connect(this, &QTreeWidget::itemExpanded, this, &DiscoListView::scheduleInfoUpdate);
+
     installEventFilter(this);
     setHeaderLabels(QStringList() << tr("Name") << tr("JID") << tr("Node"));
     //    header()->setResizeMode(0, QHeaderView::Stretch);
@@ -692,6 +795,33 @@ void DiscoListView::resizeEvent(QResizeEvent *e)
     h->resizeSection(0, int(remainingWidth * 0.7f));
 
     // h->adjustHeaderSize();
+
+    scheduleInfoUpdate();
+}
+
+void DiscoListView::scheduleInfoUpdate()
+{
+    if (!infoTimer->isActive())
+        infoTimer->start();
+}
+
+// queue disco#info only for the items in the viewport, from top to bottom
+void DiscoListView::requestVisibleInfo()
+{
+    QList<DiscoListItem *> visible;
+
+    const int        bottom = viewport()->height();
+    QTreeWidgetItem *twi    = itemAt(QPoint(0, 0));
+    while (twi && visualItemRect(twi).top() < bottom) {
+        if (twi->type() != MoreItemsType) {
+            DiscoListItem *i = static_cast<DiscoListItem *>(twi);
+            if (i->infoPending())
+                visible.append(i);
+        }
+        twi = itemBelow(twi);
+    }
+
+    infoQueue->setPending(visible);
 }
 
 /**
@@ -790,18 +920,21 @@ bool DiscoListView::eventFilter(QObject *o, QEvent *e)
 }
 
 // returns false if parent item should not be hidden (it has visible children)
-static bool updateItemsRecursively(QTreeWidgetItem *parent, const QString &filter)
+// when \a narrowing, the filter only got longer so hidden items stay hidden
+static bool updateItemsRecursively(QTreeWidgetItem *parent, const QString &filter, bool narrowing)
 {
     bool hidden = true;
     for (int j = 0; j < parent->childCount(); j++) {
         QTreeWidgetItem *i = parent->child(j);
         if (filter.isEmpty()) {
             i->setHidden(false);
-            updateItemsRecursively(i, filter);
+            updateItemsRecursively(i, filter, false);
+        } else if (narrowing && i->isHidden()) {
+            continue;
         } else {
             bool v = true;
             if (i->isExpanded()) {
-                v = updateItemsRecursively(i, filter);
+                v = updateItemsRecursively(i, filter, narrowing);
             }
             v &= !(i->text(0).contains(filter, Qt::CaseInsensitive)
                    || i->text(1).contains(filter, Qt::CaseInsensitive));
@@ -814,10 +947,17 @@ static bool updateItemsRecursively(QTreeWidgetItem *parent, const QString &filte
 
 void DiscoListView::updateItemsVisibility(const QString &filter)
 {
+    bool narrowing = !lastFilter.isEmpty() && filter.contains(lastFilter, Qt::CaseInsensitive);
+    lastFilter     = filter;
+
+    setUpdatesEnabled(false);
     for (int n = 0; n < topLevelItemCount(); n++) {
         QTreeWidgetItem *it = topLevelItem(n);
-        updateItemsRecursively(it, filter);
+        updateItemsRecursively(it, filter, narrowing);
     }
+    setUpdatesEnabled(true);
+
+    scheduleInfoUpdate();
 }
 
 //----------------------------------------------------------------------------
@@ -904,14 +1044,17 @@ DiscoDlg::Private::Private(DiscoDlg *parent, PsiAccount *pa)
     connect(data.tasks, SIGNAL(finished()), SLOT(itemUpdateFinished()));
     data.d = new DiscoConnector(this);
     connect(data.d, SIGNAL(itemUpdated(QTreeWidgetItem *)), SLOT(itemSelected(QTreeWidgetItem *)));
+    data.infoQueue = new DiscoInfoQueue(this);
 
     // mess with widgets
     busy = parent->busy;
     connect(busy, SIGNAL(destroyed(QObject *)), SLOT(objectDestroyed(QObject *)));
 
-    QTreeWidget *lv_discoOld = dlg->lv_disco;
-    dlg->lv_disco            = new DiscoListView(dlg);
+    QTreeWidget *  lv_discoOld = dlg->lv_disco;
+    DiscoListView *lv_disco    = new DiscoListView(dlg, data.infoQueue);
+    dlg->lv_disco              = lv_disco;
     replaceWidget(lv_discoOld, dlg->lv_disco);
+    connect(data.d, &DiscoConnector::itemsChanged, lv_disco, &DiscoListView::scheduleInfoUpdate);
 
     dlg->lv_disco->installEventFilter(this);
     dlg->le_filter->installEventFilter(this);
@@ -1041,6 +1184,7 @@ void DiscoDlg::Private::doDisco(QString _host, QString _node, bool doHistory)
     updateComboBoxes(jid, node);
 
     data.tasks->clear(); // also will call all all necessary functions
+    data.infoQueue->clear();
     disableButtons();
     updateBackForward();
 
@@ -1071,7 +1215,11 @@ void DiscoDlg::Private::updateComboBoxes(Jid j, QString n)
     dlg->cb_node->addItems(data.pa->psi()->recentNodeList());
 }
 
-void DiscoDlg::Private::actionStop() { data.tasks->clear(); }
+void DiscoDlg::Private::actionStop()
+{
+    data.tasks->clear();
+    data.infoQueue->clear();
+}
 
 void DiscoDlg::Private::actionRefresh()
 {
@@ -1698,8 +1698,7 @@ void EventDlg::updateEvent(const PsiEvent::Ptr &e)
 
         if (!xhtml) {
             txt = TextUtil::linkify(txt);
-            txt = TextUtil::emoticonify(txt);
-            txt = TextUtil::legacyFormat(txt);
+            txt = TextUtil::formatMessage(txt, true, true);
         }
 
         if (e->type() == PsiEvent::HttpAuth)
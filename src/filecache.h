@@ -176,6 +176,9 @@ public:
     QByteArray     getData(const XMPP::Hash &id, bool reborn = false);
     void           sync(bool finishSession);
 
+    // all the cached items. an item is listed once for each of its hash sums
+    inline const QHash<XMPP::Hash, FileCacheItem *> &items() const { return _items; }
+
 protected:
     /**
      * @brief removeItem item from disk, shedules registry update as well if required.
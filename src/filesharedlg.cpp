@@ -63,14 +63,29 @@ FileShareDlg::FileShareDlg(PsiAccount *acc, const XMPP::Jid &myJid, const QList<
 
     for (auto const &pi : items) {
         QFileInfo fi(pi->fileName());
-        auto      tr = filesModel->addTransfer(MultiFileTransferModel::Outgoing, fi.fileName(), quint64(fi.size()));
-        tr->setThumbnail(pi->thumbnail(QSize(64, 64)));
+        auto transfer = filesModel->addTransfer(MultiFileTransferModel::Outgoing, fi.fileName(), quint64(fi.size()));
+        transfer->setThumbnail(pi->thumbnail(QSize(64, 64)));
         if (pi->isPublished()) {
-            tr->setCurrentSize(quint64(fi.size()));
-            tr->setState(MultiFileTransferModel::Done);
+            transfer->setCurrentSize(quint64(fi.size()));
+            transfer->setState(MultiFileTransferModel::Done);
+        } else if (pi->isHashing()) {
+            // big files are still being hashed. they can't be shared without hash sums
+            hashingCount++;
+            transfer->setState(MultiFileTransferModel::Pending, tr("Computing checksums"));
+            connect(pi, &FileSharingItem::hashingProgress, transfer, &MultiFileTransferItem::setCurrentSize);
+            connect(pi, &FileSharingItem::hashingFinished, this, [this, pi, transfer]() {
+                transfer->setCurrentSize(0);
+                if (pi->sums().isEmpty())
+                    transfer->setFailure(tr("Failed to read the file"));
+                else
+                    transfer->setState(MultiFileTransferModel::Pending);
+                if (!--hashingCount)
+                    ui->buttonBox->button(QDialogButtonBox::Apply)->setEnabled(true);
+            });
         }
-        tr->setProperty("publisher", QVariant::fromValue<FileSharingItem *>(pi));
+        transfer->setProperty("publisher", QVariant::fromValue<FileSharingItem *>(pi));
     }
+    shareBtn->setDisabled(hashingCount > 0);
 
     QImage preview;
     if (items.count() > 1
@@ -110,6 +125,11 @@ void FileShareDlg::publish()
             readyPublishers.append(publisher);
             return;
         }
+        if (publisher->sums().isEmpty()) { // hashing failed
+            item->setState(MultiFileTransferModel::Failed);
+            hasFailures = true;
+            return;
+        }
         item->setState(MultiFileTransferModel::Active);
         connect(publisher, &FileSharingItem::publishProgress, this,
                 [item](size_t progress) { item->setCurrentSize(progress); });
@@ -138,7 +158,16 @@ void FileShareDlg::publish()
         p->publish(myJid);
 }
 
-FileShareDlg::~FileShareDlg() { delete ui; }
+FileShareDlg::~FileShareDlg()
+{
+    // nobody is interested in the sums anymore
+    filesModel->forEachTransfer([](MultiFileTransferItem *item) {
+        auto publisher = item->property("publisher").value<FileSharingItem *>();
+        if (publisher && publisher->isHashing())
+            publisher->cancelHashing();
+    });
+    delete ui;
+}
 
 void FileShareDlg::finish()
 {
@@ -163,8 +192,14 @@ void FileShareDlg::finish()
 
             references.append(r);
         }
-        delete i;
     }
+    readyPublishers.clear();
+
+    // failed ones are never ready, so free all the items here
+    filesModel->forEachTransfer([](MultiFileTransferItem *item) {
+        delete item->property("publisher").value<FileSharingItem *>();
+        item->setProperty("publisher", QVariant());
+    });
     publishedCallback(std::move(references), desc);
     if (!hasFailures)
         deleteLater();
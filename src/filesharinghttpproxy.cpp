@@ -28,11 +28,21 @@
 #include "qhttpserverresponse.hpp"
 #include "webserver.h"
 
+#include <QSocketNotifier>
 #include <QTcpSocket>
 #include <cinttypes>
 #include <tuple>
 
-#define HTTP_CHUNK (512 * 1024 * 1024)
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
+
+#define HTTP_CHUNK (512 * 1024)
+// first bytes of a local file are written via qhttp together with the headers
+#define HTTP_HEAD_CHUNK (64 * 1024)
+// max bytes sent with sendfile() in one event loop iteration
+#define SENDFILE_CHUNK (4 * 1024 * 1024)
 
 FileSharingHttpProxy::FileSharingHttpProxy(PsiAccount *acc, const QString &sourceIdHex,
                                            qhttp::server::QHttpRequest *req, qhttp::server::QHttpResponse *res) :
@@ -188,11 +198,11 @@ void FileSharingHttpProxy::proxyCache()
         emit request->end();
         return; // handled with error
     }
-    QFile *   file = new QFile(item->fileName(), response);
-    QFileInfo fi(*file);
-    if (!file->open(QIODevice::ReadOnly)) {
+    cacheFile = new QFile(item->fileName(), this);
+    QFileInfo fi(*cacheFile);
+    if (!cacheFile->open(QIODevice::ReadOnly)) {
         response->setStatusCode(qhttp::ESTATUS_NOT_FOUND);
-        qWarning("FSP failed to open cached file: %s", qPrintable(file->errorString()));
+        qWarning("FSP failed to open cached file: %s", qPrintable(cacheFile->errorString()));
         emit request->end();
         return; // handled with error
     }
@@ -202,24 +212,118 @@ void FileSharingHttpProxy::proxyCache()
             size = (requestedStart + requestedSize) > fi.size() ? fi.size() - requestedStart : requestedSize;
         else // remaining part
             size = fi.size() - requestedStart;
-        file->seek(requestedStart);
     }
     // TODO If-Modified-Since
     setupHeaders(fi.size(), item->mimeType(), fi.lastModified(), isRanged, requestedStart, size);
-    connect(response, &qhttp::server::QHttpResponse::allBytesWritten, file, [this, file, size]() {
-        qint64 toWrite = requestedStart + size - file->pos();
-        if (!toWrite) {
-            return;
+    headersSent = true;
+
+    cacheStart = isRanged ? requestedStart : 0;
+    cachePos   = cacheStart;
+    cacheEnd   = cacheStart + size;
+    cacheTimer.start();
+    if (!size) {
+        response->end();
+        return;
+    }
+
+    connect(response, &qhttp::server::QHttpResponse::allBytesWritten, this, &FileSharingHttpProxy::sendCache);
+    sendCache();
+}
+
+/**
+ * @brief Writes next part of a local file to the response.
+ *
+ * The first chunk always goes through qhttp so the headers are flushed. When the socket write buffer is empty
+ * the rest is sent with sendfile() where available, and with plain reads otherwise. The file isn't mapped to
+ * memory since a linked file may be truncated by its owner at any time, which would crash on access.
+ */
+void FileSharingHttpProxy::sendCache()
+{
+    if (cachePos == cacheEnd) {
+        return;
+    }
+
+    if (cachePos != cacheStart && cacheZeroCopy && sendCacheZeroCopy()) {
+        return;
+    }
+
+    qint64     toWrite = qMin(cacheEnd - cachePos, qint64(cachePos == cacheStart ? HTTP_HEAD_CHUNK : HTTP_CHUNK));
+    QByteArray data;
+    if (cacheFile->seek(cachePos))
+        data = cacheFile->read(toWrite);
+
+    if (data.size() != toWrite) { // the file was truncated meanwhile. the promised length can't be satisfied
+        qWarning("FSP failed to read cached file: %s", qPrintable(cacheFile->errorString()));
+        response->connection()->tcpSocket()->abort();
+        return;
+    }
+
+    cachePos += toWrite;
+    if (cachePos == cacheEnd) {
+        response->end(data);
+        qDebug("FSP served %lld bytes in %lld ms", cacheEnd - cacheStart, cacheTimer.elapsed());
+    } else
+        response->write(data);
+}
+
+/**
+ * @brief Sends the file directly from the page cache to the socket bypassing user space.
+ * @return false if the caller has to write the data itself
+ */
+bool FileSharingHttpProxy::sendCacheZeroCopy()
+{
+#ifdef Q_OS_LINUX
+    auto socket = response->connection()->tcpSocket();
+    if (socket->bytesToWrite()) {
+        return true; // allBytesWritten will come later
+    }
+
+    int    socketFd = int(socket->socketDescriptor());
+    qint64 budget   = SENDFILE_CHUNK;
+    while (cachePos < cacheEnd && budget > 0) {
+        off_t   offset = off_t(cachePos);
+        ssize_t sent   = ::sendfile(socketFd, cacheFile->handle(), &offset, size_t(qMin(cacheEnd - cachePos, budget)));
+        if (sent > 0) {
+            cachePos += sent;
+            budget -= sent;
+            continue;
         }
-        if (toWrite > HTTP_CHUNK)
-            response->write(file->read(HTTP_CHUNK));
-        else
-            response->end(file->read(toWrite));
-    });
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break; // wait till the socket is writable again
+        }
+        if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            // sendfile is not supported for this file. do it the usual way
+            cacheZeroCopy = false;
+            if (writeNotifier)
+                writeNotifier->setEnabled(false);
+            return false;
+        }
+        qWarning("FSP sendfile failed: %s", sent ? qt_error_string(errno).toLocal8Bit().constData() : "eof");
+        socket->abort();
+        return true;
+    }
+
+    if (cachePos == cacheEnd) {
+        if (writeNotifier)
+            writeNotifier->setEnabled(false);
+        response->end();
+        qDebug("FSP served %lld bytes in %lld ms (sendfile)", cacheEnd - cacheStart, cacheTimer.elapsed());
+        return true;
+    }
 
-    if (size < HTTP_CHUNK) {
-        response->end(file->read(size));
+    // QTcpSocket keeps its own write notifier disabled while its buffer is empty, so we can use our one
+    if (!writeNotifier) {
+        writeNotifier = new QSocketNotifier(socket->socketDescriptor(), QSocketNotifier::Write, this);
+        connect(writeNotifier, &QSocketNotifier::activated, this, &FileSharingHttpProxy::sendCache);
     }
+    writeNotifier->setEnabled(true);
+    return true;
+#else
+    return false;
+#endif
 }
 
 void FileSharingHttpProxy::onMetadataChanged()
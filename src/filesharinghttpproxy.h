@@ -20,10 +20,13 @@
 #ifndef FILESHARINGHTTPPROXY_H
 #define FILESHARINGHTTPPROXY_H
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QPointer>
 
 class FileCacheItem;
+class QFile;
+class QSocketNotifier;
 class FileSharingItem;
 class FileShareDownloader;
 class PsiAccount;
@@ -46,12 +49,14 @@ public slots:
 private slots:
     void onMetadataChanged();
     void transfer();
+    void sendCache();
 
 private:
     int  parseHttpRangeRequest();
     void setupHeaders(qint64 fileSize, QString contentType, QDateTime lastModified, bool isRanged, qint64 rangeStart,
                       qint64 rangeSize);
     void proxyCache();
+    bool sendCacheZeroCopy();
 
 private:
     FileSharingItem *             item = nullptr;
@@ -64,6 +69,15 @@ private:
     qint64                        bytesLeft      = -1; // -1 - unknown
     bool                          isRanged       = false;
     bool                          headersSent    = false;
+
+    // serving of a local file
+    QFile *          cacheFile     = nullptr;
+    bool             cacheZeroCopy = true; // false if sendfile() isn't supported for the file
+    qint64           cacheStart    = 0;
+    qint64           cachePos      = 0;
+    qint64           cacheEnd      = 0;
+    QSocketNotifier *writeNotifier = nullptr;
+    QElapsedTimer    cacheTimer;
 };
 
 #endif // FILESHARINGHTTPPROXY_H
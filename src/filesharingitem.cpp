@@ -31,17 +31,95 @@
 #include <QBuffer>
 #include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileIconProvider>
 #include <QImageReader>
 #include <QMimeDatabase>
 #include <QPainter>
 #include <QTemporaryFile>
+#include <QtConcurrentRun>
+
+#include <atomic>
+#include <list>
+#include <memory>
 
 #define TEMP_TTL (7 * 24 * 3600)
 #define FILE_TTL (365 * 24 * 3600)
 
+#define HASH_CHUNK_SIZE (1024 * 1024)
+#define HASH_PROGRESS_INTERVAL 100 // ms
+
 using namespace XMPP;
 
+// ======================================================================
+// FileHasher
+// ======================================================================
+// Computes all the advertised hash sums of a local file in one read pass in
+// a thread pool. The object deletes itself when the job is done, so a canceled
+// job never touches the FileSharingItem which started it.
+class FileHasher : public QObject {
+    Q_OBJECT
+public:
+    FileHasher(const QString &fileName) : _fileName(fileName) { }
+
+    void start()
+    {
+        QtConcurrent::run([this]() {
+            run();
+            emit finished();
+            deleteLater();
+        });
+    }
+
+    inline void                     cancel() { _canceled = true; }
+    inline const QList<XMPP::Hash> &sums() const { return _sums; }
+
+signals:
+    void progress(quint64 processedBytes);
+    void finished();
+
+private:
+    void run()
+    {
+        QFile file(_fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        std::list<std::pair<Hash::Type, std::unique_ptr<QCryptographicHash>>> hashes;
+        hashes.emplace_back(Hash::Sha1, new QCryptographicHash(QCryptographicHash::Sha1));
+        hashes.emplace_back(Hash::Sha256, new QCryptographicHash(QCryptographicHash::Sha256));
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        hashes.emplace_back(Hash::Blake2b256, new QCryptographicHash(QCryptographicHash::Blake2b_256));
+#endif
+
+        QByteArray    buf(HASH_CHUNK_SIZE, Qt::Uninitialized);
+        quint64       processed = 0;
+        QElapsedTimer timer;
+        timer.start();
+        while (!file.atEnd()) {
+            if (_canceled)
+                return;
+            auto len = file.read(buf.data(), buf.size());
+            if (len < 0)
+                return;
+            for (auto &h : hashes)
+                h.second->addData(buf.constData(), int(len));
+            processed += quint64(len);
+            if (timer.elapsed() >= HASH_PROGRESS_INTERVAL) {
+                timer.restart();
+                emit progress(processed);
+            }
+        }
+
+        for (auto &h : hashes)
+            _sums.append(Hash(h.first, h.second->result()));
+    }
+
+    QString           _fileName;
+    std::atomic_bool  _canceled { false };
+    QList<XMPP::Hash> _sums;
+};
+
 // ======================================================================
 // FileSharingItem
 // ======================================================================
@@ -115,17 +193,35 @@ FileSharingItem::FileSharingItem(const QString &fileName, PsiAccount *acc, FileS
     if (!file.open(QIODevice::ReadOnly))
         return;
 
-    auto h = Hash::from(Hash::Sha1, &file);
-    if (!h.isValid())
-        return;
-
-    _sums.append(h);
+    QFileInfo fi(file);
+    _fileSize   = quint64(fi.size());
+    _modifyTime = fi.lastModified().toUTC();
+    _mimeType   = QMimeDatabase().mimeTypeForFileNameAndData(fileName, &file).name();
 
-    if (!initFromCache()) {
-        file.seek(0);
-        _fileSize = quint64(file.size());
-        _mimeType = QMimeDatabase().mimeTypeForFileNameAndData(fileName, &file).name();
+    // the file was already hashed and it's not changed since then
+    _sums = _manager->linkedFileSums(fi);
+    if (_sums.size()) {
+        initFromCache();
+        return;
     }
+
+    // hashing of big files takes a while. do it in background
+    _flags |= Hashing;
+    _hasher = new FileHasher(fileName);
+    connect(_hasher, &FileHasher::progress, this, &FileSharingItem::hashingProgress);
+    connect(_hasher, &FileHasher::finished, this, [this, fi, hasher = _hasher]() {
+        if (hasher != _hasher)
+            return; // canceled or restarted meanwhile
+        _sums   = hasher->sums();
+        _hasher = nullptr;
+        _flags &= ~Hashing;
+        if (_sums.size()) {
+            _manager->rememberLinkedFile(fi, _sums);
+            initFromCache();
+        }
+        emit hashingFinished();
+    });
+    _hasher->start();
 }
 
 FileSharingItem::FileSharingItem(const QString &mime, const QByteArray &data, const QVariantMap &metaData,
@@ -154,6 +250,7 @@ FileSharingItem::FileSharingItem(const QString &mime, const QByteArray &data, co
 
 FileSharingItem::~FileSharingItem()
 {
+    cancelHashing();
     if (_fileType == FileType::TempFile && !_fileName.isEmpty()) {
         QFile f(_fileName);
         if (f.exists())
@@ -161,6 +258,20 @@ FileSharingItem::~FileSharingItem()
     }
 }
 
+/**
+ * @brief Stops background hashing of a local file. hashingFinished() won't be emitted.
+ */
+void FileSharingItem::cancelHashing()
+{
+    if (!_hasher)
+        return;
+
+    _hasher->disconnect(this);
+    _hasher->cancel();
+    _hasher = nullptr;
+    _flags &= ~Hashing;
+}
+
 bool FileSharingItem::initFromCache(FileCacheItem *cache)
 {
     if (!cache && _sums.size())
@@ -331,7 +442,10 @@ void FileSharingItem::publish(const XMPP::Jid &myJid)
                     _fileName = _manager->cacheDir() + "/" + cache->fileName();
                 }
             } else {
-                meta["link"] = _fileName;
+                QFileInfo fi(_fileName);
+                meta["link"]  = _fileName;
+                meta["size"]  = fi.size();
+                meta["mtime"] = fi.lastModified().toUTC();
                 _manager->saveToCache(_sums, QByteArray(), meta, FILE_TTL);
             }
             _flags |= PublishNotified;
@@ -485,3 +599,5 @@ QUrl FileSharingItem::simpleSource() const
     }
     return QUrl();
 }
+
+#include "filesharingitem.moc"
@@ -26,6 +26,7 @@
 #include <QObject>
 
 class FileCacheItem;
+class FileHasher;
 class FileShareDownloader;
 class FileSharingManager;
 class PsiAccount;
@@ -60,6 +61,7 @@ public:
         JingleFinished  = 0x2,
         PublishNotified = 0x4,
         SizeKnown       = 0x8,
+        Hashing         = 0x10, // hash sums of a local file are being computed in background
     };
     Q_DECLARE_FLAGS(Flags, Flag)
 
@@ -82,6 +84,7 @@ public:
     inline QVariantMap        metaData() const { return _metaData; }
     inline quint64            fileSize() const { return _fileSize; }
     inline bool               isSizeKnown() const { return bool(_flags & SizeKnown); }
+    inline bool               isHashing() const { return bool(_flags & Hashing); }
     inline const QStringList &uris() const { return _uris; }
 
     // reborn flag updates ttl for the item
@@ -111,10 +114,14 @@ public:
 
     QUrl simpleSource() const;
 
+    void cancelHashing();
+
 private:
     bool initFromCache(FileCacheItem *cache = nullptr);
 
 signals:
+    void hashingProgress(quint64 processedBytes);
+    void hashingFinished(); // sums() is empty if hashing failed or was canceled
     void publishFinished();
     void publishProgress(size_t transferredBytes);
     void downloadFinished();
@@ -124,6 +131,7 @@ private:
     PsiAccount *         _acc        = nullptr;
     FileSharingManager * _manager    = nullptr;
     FileShareDownloader *_downloader = nullptr;
+    FileHasher *         _hasher     = nullptr;
     FileType             _fileType;
     Flags                _flags;
     quint64              _fileSize = 0;
@@ -53,8 +53,16 @@
 // ======================================================================
 class FileSharingManager::Private {
 public:
+    struct LinkedFile {
+        qint64            size;
+        QDateTime         mtime; // utc
+        QList<XMPP::Hash> sums;
+    };
+
     FileCache *                          cache;
     QHash<XMPP::Hash, FileSharingItem *> items;
+    QHash<QString, LinkedFile>           linkedFiles; // absolute path => last known state
+    bool                                 linkedFilesIndexed = false;
 
     void rememberItem(FileSharingItem *item)
     {
@@ -62,6 +70,20 @@ public:
         for (auto const &v : item->sums())
             items.insert(v, item); // TODO ensure we don't overwrite
     }
+
+    // published local files are kept in the cache as links. reuse their hash sums
+    void indexLinkedFiles()
+    {
+        linkedFilesIndexed = true;
+        for (auto const &ci : cache->items()) {
+            auto md    = ci->metadata();
+            auto link  = md.value(QLatin1String("link")).toString();
+            auto mtime = md.value(QLatin1String("mtime")).toDateTime();
+            if (link.isEmpty() || !mtime.isValid())
+                continue;
+            linkedFiles.insert(QFileInfo(link).absoluteFilePath(), { md.value(QLatin1String("size")).toLongLong(), mtime, ci->sums() });
+        }
+    }
 };
 
 FileSharingManager::FileSharingManager(QObject *parent) : QObject(parent), d(new Private)
@@ -120,6 +142,22 @@ FileCacheItem *FileSharingManager::moveToCache(const QList<XMPP::Hash> &sums, co
     return d->cache->moveToCache(sums, file, metadata, maxAge);
 }
 
+QList<Hash> FileSharingManager::linkedFileSums(const QFileInfo &fi)
+{
+    if (!d->linkedFilesIndexed)
+        d->indexLinkedFiles();
+
+    auto it = d->linkedFiles.constFind(fi.absoluteFilePath());
+    if (it == d->linkedFiles.constEnd() || it->size != fi.size() || it->mtime != fi.lastModified().toUTC())
+        return QList<Hash>();
+    return it->sums;
+}
+
+void FileSharingManager::rememberLinkedFile(const QFileInfo &fi, const QList<Hash> &sums)
+{
+    d->linkedFiles.insert(fi.absoluteFilePath(), { fi.size(), fi.lastModified().toUTC(), sums });
+}
+
 FileSharingItem *FileSharingManager::item(const Hash &id) { return d->items.value(id); }
 
 QList<FileSharingItem *> FileSharingManager::fromMimeData(const QMimeData *data, PsiAccount *acc)
@@ -178,11 +216,9 @@ QList<FileSharingItem *> FileSharingManager::fromMimeData(const QMimeData *data,
         }
     } else {
         for (auto const &f : files) {
-            auto item = new FileSharingItem(f, acc, this);
-            if (!item->sums().count())
-                continue; // failed to calculate checksum. permissions problem?
-            d->rememberItem(item);
-            ret.append(item);
+            auto item = fromLocalFile(f, acc);
+            if (item)
+                ret.append(item);
         }
     }
 
@@ -197,14 +233,32 @@ QList<FileSharingItem *> FileSharingManager::fromFilesList(const QStringList &fi
     for (const QString &file : fileList) {
         QFileInfo fi(file);
         if (fi.isFile() && fi.isReadable()) {
-            auto item = new FileSharingItem(file, acc, this);
-            d->rememberItem(item);
-            ret << item;
+            auto item = fromLocalFile(file, acc);
+            if (item)
+                ret << item;
         }
     }
     return ret;
 }
 
+FileSharingItem *FileSharingManager::fromLocalFile(const QString &fileName, PsiAccount *acc)
+{
+    auto item = new FileSharingItem(fileName, acc, this);
+    if (!item->isHashing() && !item->sums().count()) {
+        delete item; // failed to open the file. permissions problem?
+        return nullptr;
+    }
+    if (item->isHashing()) {
+        connect(item, &FileSharingItem::hashingFinished, this, [this, item]() {
+            if (item->sums().count()) // otherwise failed to read the file. permissions problem?
+                d->rememberItem(item);
+        });
+    } else {
+        d->rememberItem(item);
+    }
+    return item;
+}
+
 void FileSharingManager::fillMessageView(MessageView &mv, const Message &m, PsiAccount *acc)
 {
     auto refs = m.references();
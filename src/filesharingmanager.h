@@ -77,6 +77,10 @@ public:
     FileCacheItem *moveToCache(const QList<XMPP::Hash> &sums, const QFileInfo &data, const QVariantMap &metadata,
                                unsigned int maxAge);
 
+    // hash sums of a local file computed earlier if the file wasn't modified since then
+    QList<XMPP::Hash> linkedFileSums(const QFileInfo &fi);
+    void              rememberLinkedFile(const QFileInfo &fi, const QList<XMPP::Hash> &sums);
+
     FileSharingItem *item(const XMPP::Hash &id);
     // FileSharingItem* fromReference(const XMPP::Reference &ref, PsiAccount *acc);
     QList<FileSharingItem *> fromMimeData(const QMimeData *data, PsiAccount *acc);
@@ -97,6 +101,8 @@ signals:
 public slots:
 
 private:
+    FileSharingItem *fromLocalFile(const QString &fileName, PsiAccount *acc);
+
     class Private;
     QScopedPointer<Private> d;
 };
@@ -20,13 +20,16 @@
 
 #include <QBuffer>
 #include <QDesktopServices>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFileIconProvider>
+#include <QFuture>
 #include <QKeyEvent>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPainter>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 typedef quint64 LARGE_TYPE;
 
@@ -64,6 +67,8 @@ static int calcTotalSteps(qlonglong big, int shift)
 
 static int calcProgressStep(qlonglong big, int complement, int shift) { return int((big + complement) >> shift); }
 
+#define PROGRESS_INTERVAL 100 // ms
+
 static QStringList *activeFiles = nullptr;
 
 static void active_file_add(const QString &s)
@@ -107,13 +112,100 @@ public:
     int           shift;
     int           complement;
     QString       activeFile;
+
+    // file i/o is done in a thread pool one window ahead of (or behind) the network.
+    // the jobs use their own handle, the GUI thread touches it only when no job is running
+    QFile *             io = nullptr;
+    qint64              windowSize;
+    QByteArray          buffer;        // sending: data read ahead, receiving: data not yet written
+    int                 bufferPos = 0; // sending: part of the buffer already passed to the stream
+    qlonglong           readPos   = 0; // sending: file offset of the next read
+    QFuture<QByteArray> readJob;
+    QFuture<bool>       writeJob;
+    bool                sendScheduled = false;
+    QElapsedTimer       progressTimer;
+
+    void waitIO()
+    {
+        readJob.waitForFinished();
+        writeJob.waitForFinished();
+    }
+
+    // f is opened and positioned already. the jobs get a separate handle at the same offset
+    bool openIO()
+    {
+        delete io;
+        io      = new QFile(f.fileName());
+        bool ok = io->open(f.openMode() & ~QIODevice::Truncate) && io->seek(f.pos());
+        f.close();
+        return ok;
+    }
+
+    void closeIO()
+    {
+        waitIO();
+        if (io)
+            io->close();
+    }
+
+    QString ioError() const { return io ? io->errorString() : f.errorString(); }
+
+    bool isOpen() const { return io && io->isOpen(); }
+
+    void startRead()
+    {
+        qint64 size = qMin(windowSize, fileSize - readPos);
+        QFile *file = io;
+        readPos += size;
+        readJob = QtConcurrent::run([file, size]() {
+            QByteArray ba(int(size), Qt::Uninitialized);
+            qint64     r = file->read(ba.data(), size);
+            if (r < 0)
+                return QByteArray();
+            ba.resize(int(r));
+            return ba;
+        });
+    }
+
+    QByteArray takeRead()
+    {
+        readJob.waitForFinished(); // normally it's ready by now
+        QByteArray ba = readJob.resultCount() ? readJob.result() : QByteArray();
+        readJob       = QFuture<QByteArray>();
+        return ba;
+    }
+
+    // returns false if writing to the file failed
+    bool writeBuffer(bool wait)
+    {
+        if (!writeJob.isFinished()) {
+            if (!wait && buffer.size() < 4 * windowSize)
+                return true; // collect more while the previous window is being written
+            writeJob.waitForFinished();
+        }
+        if (writeJob.resultCount() && !writeJob.result())
+            return false;
+
+        if (!buffer.isEmpty()) {
+            QFile *    file = io;
+            QByteArray data = buffer;
+            buffer          = QByteArray();
+            writeJob        = QtConcurrent::run([file, data]() { return file->write(data) == data.size(); });
+        }
+        if (wait) {
+            writeJob.waitForFinished();
+            return !writeJob.resultCount() || writeJob.result();
+        }
+        return true;
+    }
 };
 
 FileTransferHandler::FileTransferHandler(PsiAccount *pa, FileTransfer *ft)
 {
-    d     = new Private;
-    d->pa = pa;
-    d->c  = nullptr;
+    d             = new Private;
+    d->pa         = pa;
+    d->c          = nullptr;
+    d->windowSize = qMax(PsiOptions::instance()->getOption("options.p2p.file-transfer.window-size").toInt(), 4096);
 
     if (ft) {
         d->sending    = false;
@@ -136,6 +228,11 @@ FileTransferHandler::FileTransferHandler(PsiAccount *pa, FileTransfer *ft)
 
 FileTransferHandler::~FileTransferHandler()
 {
+    // the received data is counted in sent already, so it has to reach the file for a resume
+    if (!d->sending && d->isOpen())
+        d->writeBuffer(true);
+    d->closeIO();
+    delete d->io;
     if (!d->activeFile.isEmpty())
         active_file_remove(d->activeFile);
 
@@ -294,17 +391,20 @@ void FileTransferHandler::ft_connected()
                     ok = true;
             }
         }
-        if (!ok) {
+        if (!ok || !d->openIO()) {
             delete d->ft;
             d->ft = nullptr;
-            emit error(ErrFile, 0, d->f.errorString());
+            emit error(ErrFile, 0, d->ioError());
             return;
         }
 
         if (d->sent == d->fileSize)
             QTimer::singleShot(0, this, SLOT(doFinish()));
-        else
-            QTimer::singleShot(0, this, SLOT(trySend()));
+        else {
+            d->readPos = d->offset;
+            d->startRead();
+            scheduleSend();
+        }
     } else {
         // open the file, truncating if offset is zero, otherwise set the correct offset
         QIODevice::OpenMode m = QIODevice::ReadWrite;
@@ -319,10 +419,10 @@ void FileTransferHandler::ft_connected()
                     ok = true;
             }
         }
-        if (!ok) {
+        if (!ok || !d->openIO()) {
             delete d->ft;
             d->ft = nullptr;
-            emit error(ErrFile, 0, d->f.errorString());
+            emit error(ErrFile, 0, d->ioError());
             return;
         }
 
@@ -341,15 +441,16 @@ void FileTransferHandler::ft_readyRead(const QByteArray &a)
 {
     if (!d->sending) {
         // printf("%d bytes read\n", a.size());
-        int r = int(d->f.write(a.data(), a.size()));
-        if (r < 0) {
-            d->f.close();
+        d->buffer += a;
+        d->sent += a.size();
+        bool last = d->sent == d->fileSize;
+        if ((last || d->buffer.size() >= d->windowSize) && !d->writeBuffer(last)) {
+            d->closeIO();
             delete d->ft;
             d->ft = nullptr;
-            emit error(ErrFile, 0, d->f.errorString());
+            emit error(ErrFile, 0, d->ioError());
             return;
         }
-        d->sent += a.size();
         doFinish();
     }
 }
@@ -360,19 +461,21 @@ void FileTransferHandler::ft_bytesWritten(qint64 x)
         // printf("%d bytes written\n", x);
         d->sent += x;
         if (d->sent == d->fileSize) {
-            d->f.close();
+            d->closeIO();
             delete d->ft;
             d->ft = nullptr;
         } else
-            QTimer::singleShot(0, this, SLOT(trySend()));
-        emit progress(calcProgressStep(d->sent, d->complement, d->shift), d->sent);
+            scheduleSend();
+        reportProgress(d->sent == d->fileSize);
     }
 }
 
 void FileTransferHandler::ft_error(int x)
 {
-    if (d->f.isOpen())
-        d->f.close();
+    // keep received data for resume
+    if (!d->sending && d->isOpen())
+        d->writeBuffer(true);
+    d->closeIO();
     delete d->ft;
     d->ft = nullptr;
 
@@ -390,6 +493,8 @@ void FileTransferHandler::ft_error(int x)
 
 void FileTransferHandler::trySend()
 {
+    d->sendScheduled = false;
+
     // Since trySend comes from singleShot which is an "uncancelable"
     //   action, we should protect that d->ft is valid, for good measure
     if (!d->ft)
@@ -407,30 +512,57 @@ void FileTransferHandler::trySend()
     if (!d->ft->bsConnection())
         return;
 
-    int        blockSize = d->ft->dataSizeNeeded();
-    QByteArray a(blockSize, 0);
-    int        r = 0;
-    if (blockSize > 0)
-        r = int(d->f.read(a.data(), a.size()));
-    if (r < 0) {
-        d->f.close();
-        delete d->ft;
-        d->ft = nullptr;
-        emit error(ErrFile, 0, d->f.errorString());
+    int blockSize = d->ft->dataSizeNeeded();
+    if (blockSize <= 0)
         return;
+
+    if (d->bufferPos == d->buffer.size()) {
+        d->buffer    = d->takeRead();
+        d->bufferPos = 0;
+        if (d->buffer.isEmpty()) {
+            // read error or the file was truncated meanwhile
+            QString err = d->buffer.isNull() ? d->ioError() : tr("Unexpected end of file.");
+            d->closeIO();
+            delete d->ft;
+            d->ft = nullptr;
+            emit error(ErrFile, 0, err);
+            return;
+        }
+        if (d->readPos < d->fileSize)
+            d->startRead();
     }
-    if (r < int(a.size()))
-        a.resize(r);
+
+    QByteArray a = d->buffer.mid(d->bufferPos, blockSize);
+    d->bufferPos += a.size();
     d->ft->writeFileData(a);
 }
 
 void FileTransferHandler::doFinish()
 {
-    if (d->sent == d->fileSize) {
-        d->f.close();
+    bool finished = d->sent == d->fileSize;
+    if (finished) {
+        d->closeIO();
         delete d->ft;
         d->ft = nullptr;
     }
+    reportProgress(finished);
+}
+
+void FileTransferHandler::scheduleSend()
+{
+    // a few bytesWritten() in a row need just one trySend()
+    if (d->sendScheduled)
+        return;
+    d->sendScheduled = true;
+    QTimer::singleShot(0, this, SLOT(trySend()));
+}
+
+// the dialog doesn't need more than a few updates per second
+void FileTransferHandler::reportProgress(bool force)
+{
+    if (!force && d->progressTimer.isValid() && d->progressTimer.elapsed() < PROGRESS_INTERVAL)
+        return;
+    d->progressTimer.start();
     emit progress(calcProgressStep(d->sent, d->complement, d->shift), d->sent);
 }
 
@@ -74,6 +74,8 @@ private:
     Private *d;
 
     void mapSignals();
+    void scheduleSend();
+    void reportProgress(bool force = false);
 };
 
 class FileRequestDlg : public QDialog, public Ui::FileTrans {
@@ -42,6 +42,7 @@
 #include "messageview.h"
 #include "msgmle.h"
 #include "mucconfigdlg.h"
+#include "muchighlighter.h"
 #include "mucmanager.h"
 #include "mucreasonseditor.h"
 #include "pixmapratiolabel.h"
@@ -51,6 +52,7 @@
 #include "popupmanager.h"
 #include "psiaccount.h"
 #include "psiactionlist.h"
+#include "psicapsregsitry.h"
 #include "psicon.h"
 #include "psicontactlist.h"
 #include "psievent.h"
@@ -246,6 +248,8 @@ public:
     bool   gcSelfPresenceSupported = false;
     bool   gcSelfAvatarRequested   = false; // when self presence is not supported
 
+    QList<MUCHighlighter::Span> highlights; // in the body of the last checked message
+
     QStringList hist;
     int         histAt;
 
@@ -258,6 +262,9 @@ public:
     int logHeight;
     int chateditHeight;
 
+    QList<Message> spool; // history replayed on join. displayed at once when the live part begins
+    QTimer *       spoolTimer;
+
 public:
     bool trackBar;
     bool tabmode;
@@ -842,6 +849,12 @@ GCMainDlg::GCMainDlg(PsiAccount *pa, const Jid &j, TabManager *tabManager) : Tab
     d->hPending   = 0;
     d->connecting = false;
 
+    // in case the server doesn't send the subject after the history
+    d->spoolTimer = new QTimer(this);
+    d->spoolTimer->setSingleShot(true);
+    d->spoolTimer->setInterval(1000);
+    connect(d->spoolTimer, &QTimer::timeout, this, &GCMainDlg::flushSpool);
+
     d->histAt = 0;
     // d->findDlg = 0;
     d->configDlg  = nullptr;
@@ -1192,6 +1205,7 @@ void GCMainDlg::scrollDown() { ui_.log->scrollDown(); }
 void GCMainDlg::closeEvent(QCloseEvent *e)
 {
     e->accept();
+    flushSpool();
     if (d->state != Private::Connected)
         account()->groupChatLeave(d->dlg->jid().domain(), d->dlg->jid().node());
 }
@@ -1631,6 +1645,7 @@ void GCMainDlg::configureRoom()
 
 void GCMainDlg::goDisc()
 {
+    flushSpool(); // the history which came so far goes before the notice
     if (d->state != Private::Idle && d->state != Private::ForcedLeave) {
         d->state = Private::Idle;
         d->actions->action("gchat_set_topic")->setEnabled(false);
@@ -2011,6 +2026,8 @@ void GCMainDlg::presence(const QString &nick, const Status &s)
     if (s.caps().isValid()) {
         Jid caps_jid(s.mucItem().jid().isEmpty() || !d->nonAnonymous ? Jid(jid()).withResource(nick)
                                                                      : s.mucItem().jid());
+        if (auto registry = qobject_cast<PsiCapsRegistry *>(CapsRegistry::instance()))
+            registry->countLookup(caps_jid, s.caps());
         account()->client()->capsManager()->updateCaps(caps_jid, s.caps());
     }
 
@@ -2061,6 +2078,15 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
         }
     }
 
+    if (m.spooled() && m.subjectMap().isEmpty()) {
+        if (!m.body().isEmpty()) {
+            d->spool.append(m);
+            d->spoolTimer->start();
+        }
+        return;
+    }
+    flushSpool(); // the subject or a live message marks the end of the history
+
     PsiOptions *options = PsiOptions::instance();
 
     QString topic;
@@ -2113,35 +2139,18 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
     if (m.body().isEmpty())
         return;
 
-    // code to determine if the speaker was addressing this client in chat
-    if (m.body().contains(d->self))
-        d->alert = true;
-
-    if (m.body().left(d->self.length()) == d->self)
-        d->lastReferrer = m.from().resource();
-
-    if (options->getOption("options.ui.muc.use-highlighting").toBool()) {
-        QStringList highlightWords = options->getOption("options.ui.muc.highlight-words").toStringList();
-        for (const QString &word : highlightWords) {
-            if (m.body().contains((word), Qt::CaseInsensitive)) {
-                d->alert = true;
-            }
-        }
-    }
+    const MUCHighlighter *highlighter = MUCHighlighter::instance();
+    d->alert                          = checkAlert(m);
 
     // play sound?
     if (from == d->self) {
         if (!m.spooled())
             account()->playSound(PsiAccount::eSend);
     } else {
-        if (d->alert
-            || (options->getOption("options.ui.notifications.sounds.notify-every-muc-message").toBool() && !m.spooled()
-                && !from.isEmpty()))
+        if (d->alert || (highlighter->soundForEveryMessage() && !m.spooled() && !from.isEmpty()))
             account()->playSound(PsiAccount::eGroupChat);
 
-        if (d->alert
-            || (options->getOption("options.ui.notifications.passive-popups.notify-every-muc-message").toBool()
-                && !m.spooled() && !from.isEmpty())) {
+        if (d->alert || (highlighter->popupForEveryMessage() && !m.spooled() && !from.isEmpty())) {
             if (!m.spooled() && !isActiveTab() && !m.from().resource().isEmpty()) {
                 XMPP::Jid    jid = m.from() /*.withDomain("")*/;
                 UserListItem i;
@@ -2160,6 +2169,60 @@ void GCMainDlg::message(const Message &_m, const PsiEvent::Ptr &e)
         appendMessage(m, d->alert);
 }
 
+/**
+ * Determines if the speaker was addressing this client in chat
+ */
+bool GCMainDlg::checkAlert(const Message &m)
+{
+    if (m.body().startsWith(d->self))
+        d->lastReferrer = m.from().resource();
+
+    d->highlights.clear();
+    return MUCHighlighter::instance()->match(m.body(), d->self, &d->highlights);
+}
+
+/**
+ * Displays spooled history in one go. Popups are not triggered by history and the alert
+ * sound is played at most once, and the tab and roster entry are updated once for the whole batch.
+ */
+void GCMainDlg::flushSpool()
+{
+    if (d->spool.isEmpty())
+        return;
+
+    d->spoolTimer->stop();
+    const QList<Message> spool = d->spool;
+    d->spool.clear();
+
+    int  pending  = d->pending;
+    int  hPending = d->hPending;
+    bool alert    = false;
+    ui_.log->setUpdatesEnabled(false);
+    for (const Message &m : spool) {
+        d->alert = checkAlert(m);
+        alert    = alert || (d->alert && m.from().resource() != d->self);
+        if (m.from().resource().isEmpty()) {
+            auto mv = MessageView::systemMessage(m.body());
+            mv.setDateTime(m.timeStamp());
+            dispatchMessage(mv);
+        } else
+            appendMessage(m, d->alert, true);
+    }
+    ui_.log->setUpdatesEnabled(true);
+
+    if (alert)
+        account()->playSound(PsiAccount::eGroupChat);
+
+    if (d->pending != pending || d->hPending != hPending) {
+        UserListItem *u = account()->find(d->dlg->jid().bare());
+        if (u) {
+            u->setPending(d->pending, d->hPending);
+            account()->updateEntry(*u);
+        }
+        invalidateTab();
+    }
+}
+
 void GCMainDlg::joined()
 {
     if (d->state == Private::Connecting) {
@@ -2185,7 +2248,7 @@ bool GCMainDlg::isLastMessageAlert() const { return d->alert; }
 void GCMainDlg::appendSysMsg(const QString &str, bool alert)
 {
     MessageView mv = MessageView::systemMessage(str);
-    mv.setAlert(alert && PsiOptions::instance()->getOption(QStringLiteral("options.ui.muc.use-highlighting")).toBool());
+    mv.setAlert(alert && MUCHighlighter::instance()->isEnabled());
     dispatchMessage(mv);
 }
 
@@ -2199,7 +2262,11 @@ void GCMainDlg::dispatchMessage(const MessageView &mv)
         doAlert();
 }
 
-void GCMainDlg::appendMessage(const Message &m, bool alert)
+/**
+ * Shows a message from a room occupant. In \a batched mode the caller is responsible
+ * for the tab and roster updates.
+ */
+void GCMainDlg::appendMessage(const Message &m, bool alert, bool batched)
 {
     // figure out the encryption state
     bool encChanged = false;
@@ -2226,16 +2293,20 @@ void GCMainDlg::appendMessage(const Message &m, bool alert)
     }
 
     MessageView mv(MessageView::Message);
+    bool        plain = false;
     if (m.containsHTML() && PsiOptions::instance()->getOption("options.html.muc.render").toBool()
         && !m.html().text().isEmpty()) {
         mv.setHtml(m.html().toString("span"));
     } else {
         mv.setPlainText(m.body());
+        plain = true;
     }
-    if (!PsiOptions::instance()->getOption("options.ui.muc.use-highlighting").toBool())
+    if (!MUCHighlighter::instance()->isEnabled())
         alert = false;
     mv.setMessageId(m.id());
     mv.setAlert(alert);
+    if (alert && plain)
+        mv.setHighlights(d->highlights); // the spans are positions in the body
     mv.setUserId(m.from().full()); // theoretically, this can be inferred from the chat dialog properties
     mv.setNick(m.from().resource());
     mv.setLocal(mv.nick() == d->self);
@@ -2251,6 +2322,10 @@ void GCMainDlg::appendMessage(const Message &m, bool alert)
         ++d->pending;
         if (alert)
             ++d->hPending;
+        if (batched) {
+            emit messageAppended(m.body(), ui_.log->textWidget());
+            return;
+        }
         UserListItem *u = account()->find(d->dlg->jid().bare());
         if (u) {
             u->setPending(d->pending, d->hPending);
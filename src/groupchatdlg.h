@@ -138,6 +138,7 @@ private slots:
     void doPasteAndSend();
     void sendTemp(const QString &);
     void psButtonEnabled();
+    void flushSpool();
     void horizSplitterMoved();
     void verticalSplitterMoved(int, int);
     void doMinimize();
@@ -155,7 +156,8 @@ private:
     bool lastWasEncrypted_ = false;
 
     void doAlert();
-    void appendMessage(const Message &, bool);
+    bool checkAlert(const Message &);
+    void appendMessage(const Message &, bool, bool batched = false);
     void setLooks();
     void setToolbuttons();
 
@@ -538,10 +538,7 @@ void DisplayProxy::displayResult(const EDBResult &r, int dir)
             QString           msg  = me->message().body();
             msg                    = TextUtil::linkify(TextUtil::plain2rich(msg));
 
-            if (emoticons)
-                msg = TextUtil::emoticonify(msg);
-            if (formatting)
-                msg = TextUtil::legacyFormat(msg);
+            msg = TextUtil::formatMessage(msg, emoticons, formatting);
 
             if (me->originLocal()) {
                 QString nick = (pa) ? TextUtil::plain2rich(pa->nick()) : tr("deleted");
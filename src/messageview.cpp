@@ -140,12 +140,9 @@ QString MessageView::formattedText() const
         int cmd = txt.indexOf(me_cmd);
         txt     = txt.remove(cmd, me_cmd.length());
     }
-    if (PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool())
-        txt = TextUtil::emoticonify(txt);
-    if (PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool())
-        txt = TextUtil::legacyFormat(txt);
-
-    return txt;
+    return TextUtil::formatMessage(txt,
+                                   PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool(),
+                                   PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool());
 }
 
 QString MessageView::formattedUserText() const
@@ -153,11 +150,9 @@ QString MessageView::formattedUserText() const
     if (!_userText.isEmpty()) {
         QString text = TextUtil::plain2rich(_userText);
         text         = TextUtil::linkify(text);
-        if (PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool())
-            text = TextUtil::emoticonify(text);
-        if (PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool())
-            text = TextUtil::legacyFormat(text);
-        return text;
+        return TextUtil::formatMessage(
+            text, PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool(),
+            PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool());
     }
     return "";
 }
@@ -193,6 +188,12 @@ QVariantMap MessageView::toVariantMap(bool isMuc, bool formatted) const
         m["id"]      = _messageId;
         if (isMuc) { // maybe w/o conditions ?
             m["alert"] = isAlert();
+            if (!_highlights.isEmpty()) {
+                QVariantList spans;
+                for (const auto &s : _highlights)
+                    spans.append(QVariant(QVariantList { s.first, s.second }));
+                m["highlights"] = spans;
+            }
         } else {
             m["awaitingReceipt"] = isAwaitingReceipt();
         }
@@ -131,6 +131,8 @@ public:
     inline XMPP::Message::CarbonDir        carbonDirection() const { return _carbon; }
     inline void                            addReference(FileSharingItem *fsi) { _references.append(fsi); }
     inline const QList<FileSharingItem *> &references() const { return _references; }
+    inline void                            setHighlights(const QList<QPair<int, int>> &spans) { _highlights = spans; }
+    inline const QList<QPair<int, int>> &  highlights() const { return _highlights; }
 
     QVariantMap toVariantMap(bool isMuc, bool formatted = false) const;
 
@@ -149,6 +151,7 @@ private:
     QString                  _replaceId;
     XMPP::Message::CarbonDir _carbon;
     QList<FileSharingItem *> _references;
+    QList<QPair<int, int>>   _highlights; // start and length of highlighted words in the plain text
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(MessageView::Flags)
@@ -19,34 +19,140 @@
 
 #include "mucaffiliationsmodel.h"
 
+#include <QDataStream>
 #include <QFont>
 #include <QMimeData>
+#include <QSet>
 #include <QVariant>
 
 using namespace XMPP;
 
-MUCAffiliationsModel::MUCAffiliationsModel() : QStandardItemModel(Unknown, 2)
+// Child rows carry the index of their list + 1 as internal id, list headers carry 0
+MUCAffiliationsModel::MUCAffiliationsModel() : QAbstractItemModel() { }
+
+QModelIndex MUCAffiliationsModel::index(int row, int column, const QModelIndex &parent) const
 {
-    QFont font;
-    font.setBold(true);
-    QVariant font_variant = QVariant::fromValue(font);
-    for (int i = 0; i < Unknown; i++) {
-        QModelIndex ind = index(i, 0, QModelIndex());
-        setData(ind, QVariant(affiliationlistindexToString(AffiliationListIndex(i))));
-        setData(ind, font_variant, Qt::FontRole);
-        insertColumns(0, 1, ind);
-        insertColumns(1, 1, ind);
-        enabled_[AffiliationListIndex(i)] = false;
+    if (row < 0 || column < 0 || column >= 2)
+        return QModelIndex();
+
+    if (!parent.isValid()) {
+        if (row >= Unknown)
+            return QModelIndex();
+        return createIndex(row, column, quintptr(0));
+    }
+
+    if (parent.internalId() != 0 || parent.column() != 0 || row >= lists_[parent.row()].jids.size())
+        return QModelIndex();
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex MUCAffiliationsModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.internalId() == 0)
+        return QModelIndex();
+    return createIndex(int(index.internalId() - 1), 0, quintptr(0));
+}
+
+int MUCAffiliationsModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return Unknown;
+    if (parent.internalId() != 0 || parent.column() != 0)
+        return 0;
+    return lists_[parent.row()].jids.size();
+}
+
+int MUCAffiliationsModel::columnCount(const QModelIndex &) const { return 2; }
+
+QVariant MUCAffiliationsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    if (index.internalId() == 0) {
+        // List headers
+        if (index.column() != 0)
+            return QVariant();
+        if (role == Qt::DisplayRole || role == Qt::EditRole)
+            return affiliationlistindexToString(AffiliationListIndex(index.row()));
+        if (role == Qt::FontRole) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
     }
-    setHorizontalHeaderLabels(QStringList() << tr("JID") << tr("Reason"));
+
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+    const AffiliationList &list = lists_[index.internalId() - 1];
+    return index.column() == 0 ? list.jids.at(index.row()) : list.reasons.at(index.row());
+}
+
+bool MUCAffiliationsModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.internalId() == 0 || (role != Qt::DisplayRole && role != Qt::EditRole))
+        return false;
+
+    AffiliationList &list = lists_[index.internalId() - 1];
+    if (index.column() == 0)
+        list.jids[index.row()] = value.toString();
+    else
+        list.reasons[index.row()] = value.toString();
+    emit dataChanged(index, index);
+    return true;
+}
+
+QVariant MUCAffiliationsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+    return section == 0 ? tr("JID") : tr("Reason");
+}
+
+bool MUCAffiliationsModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+    if (!parent.isValid() || parent.internalId() != 0 || count <= 0)
+        return false;
+
+    AffiliationList &list = lists_[parent.row()];
+    if (row < 0 || row > list.jids.size())
+        return false;
+
+    beginInsertRows(parent.sibling(parent.row(), 0), row, row + count - 1);
+    for (int i = 0; i < count; i++) {
+        list.jids.insert(row, QString());
+        list.reasons.insert(row, QString());
+    }
+    endInsertRows();
+    return true;
+}
+
+bool MUCAffiliationsModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (!parent.isValid() || parent.internalId() != 0 || count <= 0)
+        return false;
+
+    AffiliationList &list = lists_[parent.row()];
+    if (row < 0 || row + count > list.jids.size())
+        return false;
+
+    beginRemoveRows(parent.sibling(parent.row(), 0), row, row + count - 1);
+    list.jids.erase(list.jids.begin() + row, list.jids.begin() + row + count);
+    list.reasons.erase(list.reasons.begin() + row, list.reasons.begin() + row + count);
+    endRemoveRows();
+    return true;
 }
 
 Qt::ItemFlags MUCAffiliationsModel::flags(const QModelIndex &index) const
 {
     Qt::ItemFlags a;
+    if (!index.isValid())
+        return a;
+
     if (!index.parent().isValid()) {
         // List headers
-        if (enabled_[AffiliationListIndex(index.row())]) {
+        if (lists_[index.row()].enabled) {
             a |= Qt::ItemIsDropEnabled | Qt::ItemIsSelectable | Qt::ItemIsEnabled;
         }
     } else {
@@ -138,7 +244,7 @@ QMimeData *MUCAffiliationsModel::mimeData(const QModelIndexList &indexes) const
 
 void MUCAffiliationsModel::resetAffiliationLists()
 {
-    items_.clear();
+    original_.clear();
     resetAffiliationList(MUCItem::Outcast);
     resetAffiliationList(MUCItem::Member);
     resetAffiliationList(MUCItem::Admin);
@@ -147,21 +253,28 @@ void MUCAffiliationsModel::resetAffiliationLists()
 
 void MUCAffiliationsModel::resetAffiliationList(MUCItem::Affiliation a)
 {
-    emit layoutAboutToBeChanged();
-    enabled_[AffiliationListIndex(affiliationToIndex(a))] = false;
-    QModelIndex index                                     = affiliationListIndex(a);
-    if (hasChildren(index)) {
-        removeRows(0, rowCount(index), index);
+    QModelIndex index = affiliationListIndex(a);
+    if (!index.isValid())
+        return;
+
+    AffiliationList &list = lists_[index.row()];
+    if (!list.jids.isEmpty()) {
+        beginRemoveRows(index, 0, list.jids.size() - 1);
+        list.jids.clear();
+        list.reasons.clear();
+        endRemoveRows();
     }
-    emit layoutChanged();
+    setAffiliationListEnabled(a, false);
 }
 
 void MUCAffiliationsModel::setAffiliationListEnabled(MUCItem::Affiliation a, bool b)
 {
-    emit        layoutAboutToBeChanged();
-    QModelIndex index                           = affiliationListIndex(a);
-    enabled_[AffiliationListIndex(index.row())] = b;
-    emit layoutChanged();
+    QModelIndex index = affiliationListIndex(a);
+    if (!index.isValid() || lists_[index.row()].enabled == b)
+        return;
+
+    lists_[index.row()].enabled = b;
+    emit dataChanged(index, index.sibling(index.row(), 1));
 }
 
 QString MUCAffiliationsModel::affiliationlistindexToString(AffiliationListIndex list)
@@ -203,63 +316,64 @@ MUCAffiliationsModel::AffiliationListIndex MUCAffiliationsModel::affiliationToIn
 
 void MUCAffiliationsModel::addItems(const QList<MUCItem> &items)
 {
-    bool dirty = false;
+    // group the items by list first so that each list gets one insertion
+    QStringList jids[Unknown];
+    QStringList reasons[Unknown];
     for (const MUCItem &item : items) {
-        QModelIndex list = affiliationListIndex(item.affiliation());
-        if (list.isValid() && !item.jid().isEmpty()) {
-            if (!dirty) {
-                emit layoutAboutToBeChanged();
-            }
-            int row = rowCount(list);
-            if (row == 0) {
-                enabled_[AffiliationListIndex(list.row())] = true;
-            }
-            insertRows(row, 1, list);
-            setData(index(row, 0, list), QVariant(item.jid().full()));
-            setData(index(row, 1, list), QVariant(item.reason()));
-            MUCItem i(MUCItem::UnknownRole, item.affiliation());
-            i.setJid(item.jid());
-            items_ += i;
-            dirty = true;
+        AffiliationListIndex list = affiliationToIndex(item.affiliation());
+        if (list != Unknown && !item.jid().isEmpty()) {
+            jids[list] += item.jid().full();
+            reasons[list] += item.reason();
+            original_.insert(item.jid().full(), item.affiliation());
         } else {
             qDebug("Unexpected item");
         }
     }
-    if (dirty)
-        emit layoutChanged();
+
+    for (int i = 0; i < Unknown; i++) {
+        if (jids[i].isEmpty())
+            continue;
+
+        AffiliationList &list  = lists_[i];
+        QModelIndex      index = this->index(i, 0);
+        int              row   = list.jids.size();
+        if (row == 0)
+            setAffiliationListEnabled(indexToAffiliation(i));
+
+        beginInsertRows(index, row, row + jids[i].size() - 1);
+        list.jids += jids[i];
+        list.reasons += reasons[i];
+        endInsertRows();
+    }
 }
 
 QList<MUCItem> MUCAffiliationsModel::changes() const
 {
-    QList<MUCItem> items_old = items_;
     QList<MUCItem> items_delta;
+    QSet<QString>  present; // bare jids still in any list
 
-    // Add all new items
-    for (int i = 0; i < rowCount(QModelIndex()); i++) {
-        QModelIndex list = index(i, 0, QModelIndex());
-        for (int j = 0; j < rowCount(list); j++) {
-            Jid     jid(data(index(j, 0, list)).toString());
-            MUCItem item(MUCItem::UnknownRole, indexToAffiliation(i));
-            item.setJid(jid);
-            if (!items_.contains(item)) {
+    // Add all new or moved items
+    for (int i = 0; i < Unknown; i++) {
+        MUCItem::Affiliation affiliation = indexToAffiliation(i);
+        for (const QString &s : lists_[i].jids) {
+            Jid jid(s);
+            present += jid.bare();
+
+            auto it = original_.constFind(jid.full());
+            if (it == original_.constEnd() || it.value() != affiliation) {
+                MUCItem item(MUCItem::UnknownRole, affiliation);
+                item.setJid(jid);
                 items_delta += item;
-            } else
-                items_old.removeAll(item);
+            }
         }
     }
 
-    // Remove all old items not present in the delta
-    for (const MUCItem &item_old : items_old) {
-        bool found = false;
-        for (const MUCItem &item_new : qAsConst(items_delta)) {
-            if (item_new.jid().compare(item_old.jid(), false)) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
+    // Remove the affiliation of all old items which are gone from the lists
+    for (auto it = original_.constBegin(); it != original_.constEnd(); ++it) {
+        Jid jid(it.key());
+        if (!present.contains(jid.bare())) {
             MUCItem item(MUCItem::UnknownRole, MUCItem::NoAffiliation);
-            item.setJid(item_old.jid());
+            item.setJid(jid);
             items_delta += item;
         }
     }
@@ -22,19 +22,31 @@
 
 #include "xmpp_muc.h"
 
+#include <QAbstractItemModel>
+#include <QHash>
 #include <QList>
-#include <QMap>
-#include <QStandardItemModel>
+#include <QStringList>
 
 class QMimeData;
 
-class MUCAffiliationsModel : public QStandardItemModel {
+class MUCAffiliationsModel : public QAbstractItemModel {
     Q_OBJECT
 
 public:
     MUCAffiliationsModel();
 
-    virtual Qt::ItemFlags   flags(const QModelIndex &index) const;
+    // reimplemented
+    QModelIndex   index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex   parent(const QModelIndex &index) const;
+    int           rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int           columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant      data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool          setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    QVariant      headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    bool          insertRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    bool          removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+
     virtual Qt::DropActions supportedDropActions() const;
     bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent);
     QStringList mimeTypes() const;
@@ -55,8 +67,15 @@ protected:
     static XMPP::MUCItem::Affiliation indexToAffiliation(int);
 
 private:
-    QList<XMPP::MUCItem>             items_;
-    QMap<AffiliationListIndex, bool> enabled_;
+    // rows of one affiliation list, stored column-wise
+    struct AffiliationList {
+        QStringList jids;
+        QStringList reasons;
+        bool        enabled = false;
+    };
+
+    AffiliationList                            lists_[Unknown];
+    QHash<QString, XMPP::MUCItem::Affiliation> original_; // full jid => affiliation as received from the room
 };
 
 #endif // MUCAFFILIATIONSMODEL_H
@@ -6,6 +6,19 @@ MUCAffiliationsProxyModel::MUCAffiliationsProxyModel(QObject *parent) : QSortFil
     setDynamicSortFilter(true);
 }
 
+/**
+ * Shows only the list entries containing \a text. Plain substring search is
+ * used since regular expression matching is slow on lists with many entries.
+ */
+void MUCAffiliationsProxyModel::setFilterText(const QString &text)
+{
+    if (filterText_ == text)
+        return;
+
+    filterText_ = text;
+    invalidateFilter();
+}
+
 bool MUCAffiliationsProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
     QModelIndex idx = sourceModel()->index(sourceRow, 0, sourceParent);
@@ -15,5 +28,5 @@ bool MUCAffiliationsProxyModel::filterAcceptsRow(int sourceRow, const QModelInde
     if (!idx.parent().isValid())
         return true;
 
-    return filterRegExp().indexIn(idx.data().toString()) >= 0;
+    return filterText_.isEmpty() || idx.data().toString().contains(filterText_, filterCaseSensitivity());
 }
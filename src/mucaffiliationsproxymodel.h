@@ -8,8 +8,13 @@ class MUCAffiliationsProxyModel : public QSortFilterProxyModel {
 public:
     MUCAffiliationsProxyModel(QObject *parent = nullptr);
 
+    void setFilterText(const QString &text);
+
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+private:
+    QString filterText_;
 };
 
 #endif // MUCAFFILIATIONSPROXYMODEL_H
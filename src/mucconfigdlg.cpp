@@ -32,6 +32,7 @@
 #include <QMap>
 #include <QMessageBox>
 #include <QScrollArea>
+#include <QTimer>
 #include <QVariant>
 
 using namespace XMPP;
@@ -80,6 +81,12 @@ MUCConfigDlg::MUCConfigDlg(MUCManager *manager, QWidget *parent) : QDialog(paren
     connect(ui_.pb_remove, SIGNAL(clicked()), ui_.tv_affiliations, SLOT(removeCurrent()));
     connect(ui_.le_filter, SIGNAL(textChanged(const QString &)), SLOT(applyFilter(const QString &)));
 
+    // filter once the user pauses typing
+    filter_timer_ = new QTimer(this);
+    filter_timer_->setSingleShot(true);
+    filter_timer_->setInterval(150);
+    connect(filter_timer_, SIGNAL(timeout()), SLOT(updateFilter()));
+
     affiliations_model_       = new MUCAffiliationsModel();
     affiliations_proxy_model_ = new MUCAffiliationsProxyModel(affiliations_model_);
     affiliations_proxy_model_->setSourceModel(affiliations_model_);
@@ -242,7 +249,9 @@ void MUCConfigDlg::currentTabChanged(int)
     }
 }
 
-void MUCConfigDlg::applyFilter(const QString &s) { affiliations_proxy_model_->setFilterFixedString(s); }
+void MUCConfigDlg::applyFilter(const QString &) { filter_timer_->start(); }
+
+void MUCConfigDlg::updateFilter() { affiliations_proxy_model_->setFilterText(ui_.le_filter->text()); }
 
 void MUCConfigDlg::getConfiguration_success(const XData &d)
 {
@@ -30,6 +30,7 @@ class MUCAffiliationsModel;
 class MUCAffiliationsProxyModel;
 class MUCManager;
 class QScrollArea;
+class QTimer;
 class XDataWidget;
 
 namespace XMPP {
@@ -60,6 +61,7 @@ protected slots:
     void destroy();
     void currentTabChanged(int);
     void applyFilter(const QString &);
+    void updateFilter();
 
     void getConfiguration_success(const XData &);
     void getConfiguration_error(int, const QString &);
@@ -83,6 +85,7 @@ private:
     MUCAffiliationsModel *      affiliations_model_;
     MUCAffiliationsProxyModel * affiliations_proxy_model_;
     QList<MUCItem::Affiliation> pending_requests_;
+    QTimer *                    filter_timer_;
 };
 
 #endif // MUCCONFIG_H
@@ -0,0 +1,165 @@
+/*
+ * muchighlighter.cpp - matcher of highlighted words in groupchat messages
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "muchighlighter.h"
+
+#include "psioptions.h"
+
+#include <algorithm>
+
+static const QString useHighlightingOpt   = QStringLiteral("options.ui.muc.use-highlighting");
+static const QString highlightWordsOpt    = QStringLiteral("options.ui.muc.highlight-words");
+static const QString wholeWordsOpt        = QStringLiteral("options.ui.muc.highlight-whole-words");
+static const QString patternsOpt          = QStringLiteral("options.ui.muc.highlight-patterns");
+static const QString everyMessageSoundOpt = QStringLiteral("options.ui.notifications.sounds.notify-every-muc-message");
+static const QString everyMessagePopupOpt
+    = QStringLiteral("options.ui.notifications.passive-popups.notify-every-muc-message");
+
+/**
+ * \class MUCHighlighter
+ * \brief Finds the own nick and highlight words in groupchat messages
+ *
+ * All plain highlight words are compiled into one case-insensitive regular expression,
+ * which is rebuilt only when the related options change. With
+ * "options.ui.muc.highlight-patterns" a word written as /pattern/ is used as a
+ * regular expression as is, otherwise it's a plain word like /usr/ always was.
+ * Such patterns are compiled one by one, since their group numbers would shift
+ * in a joined expression.
+ */
+MUCHighlighter::MUCHighlighter() : QObject(nullptr)
+{
+    connect(PsiOptions::instance(), SIGNAL(optionChanged(const QString &)), SLOT(optionChanged(const QString &)));
+    connect(PsiOptions::instance(), SIGNAL(destroyed()), SLOT(reset()));
+
+    PsiOptions *o = PsiOptions::instance();
+    everySound_   = o->getOption(everyMessageSoundOpt).toBool();
+    everyPopup_   = o->getOption(everyMessagePopupOpt).toBool();
+    compile();
+}
+
+void MUCHighlighter::compile()
+{
+    PsiOptions *o = PsiOptions::instance();
+    enabled_      = o->getOption(useHighlightingOpt).toBool();
+    words_        = QRegularExpression();
+    patterns_.clear();
+    if (!enabled_)
+        return;
+
+    const auto options = QRegularExpression::CaseInsensitiveOption | QRegularExpression::UseUnicodePropertiesOption;
+
+    const bool  wholeWords  = o->getOption(wholeWordsOpt).toBool();
+    const bool  usePatterns = o->getOption(patternsOpt).toBool();
+    QStringList words;
+    for (const QString &word : o->getOption(highlightWordsOpt).toStringList()) {
+        if (word.isEmpty())
+            continue;
+        if (usePatterns && word.size() > 2 && word.startsWith('/') && word.endsWith('/')) {
+            QRegularExpression rx(word.mid(1, word.size() - 2), options);
+            if (!rx.isValid()) {
+                qWarning("MUCHighlighter: invalid highlight pattern %s: %s", qUtf8Printable(word),
+                         qUtf8Printable(rx.errorString()));
+                continue;
+            }
+            rx.optimize();
+            patterns_.append(rx);
+        } else if (wholeWords) {
+            words.append(QLatin1String("(?<!\\w)") + QRegularExpression::escape(word) + QLatin1String("(?!\\w)"));
+        } else {
+            words.append(QRegularExpression::escape(word));
+        }
+    }
+    if (!words.isEmpty()) {
+        words_ = QRegularExpression(words.join('|'), options);
+        words_.optimize();
+    }
+}
+
+// true if rx has a non-empty match in text. all such matches are added to spans, if it's given
+static bool findMatches(const QRegularExpression &rx, const QString &text, QList<MUCHighlighter::Span> *spans)
+{
+    bool found = false;
+    auto it    = rx.globalMatch(text);
+    while (it.hasNext()) {
+        auto m = it.next();
+        if (!m.capturedLength())
+            continue;
+        found = true;
+        if (!spans)
+            break;
+        spans->append({ m.capturedStart(), m.capturedLength() });
+    }
+    return found;
+}
+
+/**
+ * Returns \c true if \a text mentions \a nick or any of highlight words.
+ * If \a spans is not null, it's filled with positions of all matches sorted by start,
+ * so the view can mark them without scanning the text again.
+ * The nick is matched even if highlighting is disabled.
+ */
+bool MUCHighlighter::match(const QString &text, const QString &nick, QList<Span> *spans) const
+{
+    bool found = false;
+    if (!nick.isEmpty()) {
+        for (int i = text.indexOf(nick); i != -1; i = text.indexOf(nick, i + nick.size())) {
+            found = true;
+            if (!spans)
+                return true;
+            spans->append({ i, nick.size() });
+        }
+    }
+
+    if (!words_.pattern().isEmpty())
+        found = findMatches(words_, text, spans) || found;
+
+    for (const QRegularExpression &rx : patterns_) {
+        if (found && !spans)
+            return true;
+        found = findMatches(rx, text, spans) || found;
+    }
+
+    if (spans)
+        std::sort(spans->begin(), spans->end(), [](const Span &a, const Span &b) { return a.first < b.first; });
+    return found;
+}
+
+void MUCHighlighter::optionChanged(const QString &opt)
+{
+    if (opt == useHighlightingOpt || opt == highlightWordsOpt || opt == wholeWordsOpt || opt == patternsOpt)
+        compile();
+    else if (opt == everyMessageSoundOpt)
+        everySound_ = PsiOptions::instance()->getOption(opt).toBool();
+    else if (opt == everyMessagePopupOpt)
+        everyPopup_ = PsiOptions::instance()->getOption(opt).toBool();
+}
+
+/**
+ * Returns the singleton instance of this class
+ */
+MUCHighlighter *MUCHighlighter::instance()
+{
+    if (!instance_)
+        instance_.reset(new MUCHighlighter());
+    return instance_.data();
+}
+
+void MUCHighlighter::reset() { instance_.reset(nullptr); }
+
+QScopedPointer<MUCHighlighter> MUCHighlighter::instance_;
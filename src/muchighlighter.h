@@ -0,0 +1,62 @@
+/*
+ * muchighlighter.h - matcher of highlighted words in groupchat messages
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MUCHIGHLIGHTER_H
+#define MUCHIGHLIGHTER_H
+
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QRegularExpression>
+#include <QScopedPointer>
+#include <QVector>
+
+class MUCHighlighter : public QObject {
+    Q_OBJECT
+public:
+    using Span = QPair<int, int>; // start and length of a match
+
+    static MUCHighlighter *instance();
+
+    bool isEnabled() const { return enabled_; }
+    bool soundForEveryMessage() const { return everySound_; }
+    bool popupForEveryMessage() const { return everyPopup_; }
+    bool match(const QString &text, const QString &nick, QList<Span> *spans = nullptr) const;
+
+private:
+    MUCHighlighter();
+
+public slots:
+    static void reset();
+
+private slots:
+    void optionChanged(const QString &opt);
+
+private:
+    void compile();
+
+    static QScopedPointer<MUCHighlighter> instance_;
+    QRegularExpression                    words_;    // plain words joined into one expression
+    QVector<QRegularExpression>           patterns_; // /pattern/ words, kept apart for their backreferences
+    bool                                  enabled_    = false;
+    bool                                  everySound_ = false;
+    bool                                  everyPopup_ = false;
+};
+
+#endif // MUCHIGHLIGHTER_H
@@ -0,0 +1,133 @@
+/*
+ * mucjoinscheduler.cpp - throttles auto-joining of bookmarked conferences
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "mucjoinscheduler.h"
+
+#include "psicon.h"
+#include "psioptions.h"
+
+#include <QTimer>
+
+// a room which didn't answer in this time doesn't hold its slot anymore
+#define JOIN_TIMEOUT 30000 // ms
+
+/**
+ * \class MucJoinScheduler
+ * \brief Joins auto-join bookmarks a few at a time
+ *
+ * Joining all bookmarked rooms at once on login floods the client with
+ * presences, history and avatar requests. The scheduler keeps at most
+ * options.muc.bookmarks.auto-join-concurrency joins in progress and starts
+ * the recently joined rooms first.
+ */
+MucJoinScheduler::MucJoinScheduler(PsiCon *psi, QObject *parent) : QObject(parent), psi_(psi)
+{
+    // collect all bookmarks reported at once before picking the first ones
+    startTimer_ = new QTimer(this);
+    startTimer_->setSingleShot(true);
+    startTimer_->setInterval(0);
+    connect(startTimer_, &QTimer::timeout, this, &MucJoinScheduler::startNext);
+}
+
+void MucJoinScheduler::enqueue(const ConferenceBookmark &bookmark)
+{
+    const XMPP::Jid room = bookmark.jid().withResource(QString());
+    if (active_.contains(room.bare()))
+        return;
+    for (const ConferenceBookmark &c : qAsConst(queue_)) {
+        if (c.jid().bare() == room.bare())
+            return;
+    }
+
+    // keep the queue sorted by priority, in order of arrival within the same priority
+    const QStringList recent = psi_->recentGCList();
+    int               p      = priority(recent, room);
+    int               i      = queue_.size();
+    while (i > 0 && priority(recent, queue_.at(i - 1).jid()) > p)
+        --i;
+    queue_.insert(i, bookmark);
+
+    startTimer_->start();
+}
+
+/**
+ * Must be called when \a room is joined so that the next room can be joined.
+ */
+void MucJoinScheduler::joined(const XMPP::Jid &room) { finish(room, true); }
+
+/**
+ * Must be called when joining \a room failed so that the next room can be joined.
+ */
+void MucJoinScheduler::failed(const XMPP::Jid &room) { finish(room, false); }
+
+void MucJoinScheduler::clear()
+{
+    startTimer_->stop();
+    queue_.clear();
+    active_.clear();
+}
+
+void MucJoinScheduler::startNext()
+{
+    int concurrency = PsiOptions::instance()->getOption("options.muc.bookmarks.auto-join-concurrency").toInt();
+    while (!queue_.isEmpty() && (concurrency <= 0 || active_.size() < concurrency)) {
+        ConferenceBookmark bookmark = queue_.takeFirst();
+        active_[bookmark.jid().bare()].start();
+        QTimer::singleShot(JOIN_TIMEOUT, this, &MucJoinScheduler::expire);
+        emit joinRequested(bookmark);
+    }
+}
+
+void MucJoinScheduler::expire()
+{
+    for (auto it = active_.begin(); it != active_.end();) {
+        if (it.value().hasExpired(JOIN_TIMEOUT)) {
+            qDebug("MucJoinScheduler: no answer from %s in %d ms", qUtf8Printable(it.key()), JOIN_TIMEOUT);
+            it = active_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!queue_.isEmpty())
+        startTimer_->start();
+}
+
+void MucJoinScheduler::finish(const XMPP::Jid &room, bool success)
+{
+    auto it = active_.find(room.bare());
+    if (it == active_.end())
+        return;
+
+    qDebug("MucJoinScheduler: %s %s in %lld ms", qUtf8Printable(room.bare()), success ? "joined" : "failed",
+           it.value().elapsed());
+    active_.erase(it);
+
+    if (!queue_.isEmpty())
+        startTimer_->start();
+}
+
+// Lower is joined earlier. Rooms from the recent joins list go first, the most recent one first.
+int MucJoinScheduler::priority(const QStringList &recent, const XMPP::Jid &room)
+{
+    for (int i = 0; i < recent.size(); ++i) {
+        if (XMPP::Jid(recent.at(i)).bare() == room.bare())
+            return i;
+    }
+    return recent.size();
+}
@@ -0,0 +1,62 @@
+/*
+ * mucjoinscheduler.h - throttles auto-joining of bookmarked conferences
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MUCJOINSCHEDULER_H
+#define MUCJOINSCHEDULER_H
+
+#include "conferencebookmark.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+class PsiCon;
+class QTimer;
+
+class MucJoinScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    MucJoinScheduler(PsiCon *psi, QObject *parent = nullptr);
+
+    void enqueue(const ConferenceBookmark &bookmark);
+    void joined(const XMPP::Jid &room);
+    void failed(const XMPP::Jid &room);
+    void clear();
+
+signals:
+    void joinRequested(const ConferenceBookmark &bookmark);
+
+private slots:
+    void startNext();
+    void expire();
+
+private:
+    void       finish(const XMPP::Jid &room, bool success);
+    static int priority(const QStringList &recent, const XMPP::Jid &room);
+
+    PsiCon *                      psi_;
+    QTimer *                      startTimer_;
+    QList<ConferenceBookmark>     queue_;
+    QHash<QString, QElapsedTimer> active_; // bare room jid => time since join was requested
+};
+
+#endif // MUCJOINSCHEDULER_H
@@ -19,17 +19,26 @@
 
 #include "popupmanager.h"
 
+#include "iconset.h"
 #include "psiaccount.h"
 #include "psicon.h"
 #include "psioptions.h"
 #include "psipopupinterface.h"
+#include "textutil.h"
+#include "userlist.h"
 #include "xmpp_jid.h"
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QPluginLoader>
+#include <QTimer>
 #include <QtPlugin>
 
 static const int     defaultTimeout = 5;
 static const QString defaultType    = "Classic";
+static const int     burstWindow    = 3000; // ms
+static const int     burstPopups    = 3;    // status popups of one type shown per window, the rest are merged
+static const int     summaryNames   = 10;
 
 struct OptionValue {
     OptionValue(const QString &name, const QString &path, int value, int _id = 0) :
@@ -99,10 +108,74 @@ public:
         return defaultTimeout * 1000;
     }
 
+    // status popups of one type
+    struct Burst {
+        QElapsedTimer window;
+        int           shown = 0;
+        QStringList   merged; // names of contacts waiting for the summary popup
+    };
+
+    /**
+     * Returns true if the popup is merged into a summary shown when the window ends.
+     * While the storm goes on, only summaries are shown.
+     */
+    bool coalesce(PopupType type, const Jid &j, const UserListItem *u)
+    {
+        if (type != AlertOnline && type != AlertOffline && type != AlertStatusChange)
+            return false;
+
+        Burst &b = bursts_[type];
+        if (!b.window.isValid() || b.window.hasExpired(burstWindow)) {
+            bool storm = b.window.isValid() && !b.window.hasExpired(burstWindow * 2) && b.shown > burstPopups;
+            b.shown    = storm ? burstPopups : 0;
+            b.window.start();
+        }
+        if (b.shown++ < burstPopups)
+            return false;
+
+        b.merged.append(u && !u->name().isEmpty() ? u->name() : j.bare());
+        if (!summaryTimer_.isActive())
+            summaryTimer_.start(burstWindow);
+        return true;
+    }
+
+    void showSummaries(PsiPopupInterface *popup)
+    {
+        for (auto it = bursts_.begin(); it != bursts_.end(); ++it) {
+            QStringList names = it.value().merged;
+            it.value().merged.clear();
+            if (names.isEmpty() || !popup)
+                continue;
+
+            PopupType type = PopupType(it.key());
+            QString   title;
+            if (type == AlertOnline)
+                title = QObject::tr("%n more contact(s) online", "", names.count());
+            else if (type == AlertOffline)
+                title = QObject::tr("%n more contact(s) offline", "", names.count());
+            else
+                title = QObject::tr("%n more status change(s)", "", names.count());
+
+            QStringList shown = names.mid(0, summaryNames);
+            for (QString &name : shown)
+                name = TextUtil::escape(name);
+            QString text = shown.join(", ");
+            if (names.count() > summaryNames)
+                text += " " + QObject::tr("and %n more", "", names.count() - summaryNames);
+
+            const PsiIcon *icon = IconsetFactory::iconPtr(type == AlertOffline ? "status/offline" : "status/online");
+            popup->setDuration(timeout(type));
+            // no account, so clicking the summary does nothing
+            popup->popup(nullptr, type, Jid(), icon, title, QPixmap(), nullptr, text);
+        }
+    }
+
     PsiCon *                                 psi_;
     int                                      lastCustomType_;
     QList<OptionValue>                       options_;
     QMap<QString, PsiPopupPluginInterface *> popups_;
+    QHash<int, Burst>                        bursts_;
+    QTimer                                   summaryTimer_;
 };
 
 PopupManager::PopupManager(PsiCon *psi)
@@ -138,6 +211,9 @@ PopupManager::PopupManager(PsiCon *psi)
 
     d->options_ += initList;
 
+    d->summaryTimer_.setSingleShot(true);
+    QObject::connect(&d->summaryTimer_, &QTimer::timeout, [this]() { d->showSummaries(d->popup(currentType())); });
+
     const auto &stPlugins = QPluginLoader::staticInstances();
     for (QObject *plugin : stPlugins) {
         PsiPopupPluginInterface *ppi = qobject_cast<PsiPopupPluginInterface *>(plugin);
@@ -216,6 +292,9 @@ void PopupManager::doPopup(PsiAccount *account, PopupType pType, const Jid &j, c
     if (checkNoPopup && d->noPopup(account))
         return;
 
+    if (d->coalesce(pType, j, u))
+        return;
+
     PsiPopupInterface *popup = d->popup(currentType());
     if (popup) {
         popup->setDuration(d->timeout(pType));
@@ -48,6 +48,8 @@ public:
     int  defaultPriority(const XMPP::Status &s);
     void saveLastStatus(OptionsTree *o, QString base);
 
+    QString rosterCacheFile() const;
+
     QString id;
     QString name;
     QString jid, pass, host, resource, authid, realm;
@@ -25,6 +25,7 @@
 #include "chatdlg.h"
 #include "common.h"
 #include "fancylabel.h"
+#include "jidutil.h"
 #include "optionstree.h"
 #ifdef HAVE_PGPUTIL
 #include "pgputil.h"
@@ -44,6 +45,7 @@
 #include <QDomElement>
 #include <QFileInfo>
 #include <QList>
+#include <QSaveFile>
 #include <QTextStream>
 #include <QUuid>
 #include <QtCrypto>
@@ -139,6 +141,69 @@ void UserAccount::reset()
 
 UserAccount::~UserAccount() { }
 
+#define ROSTER_CACHE_MAGIC 0x50524331 // "PRC1"
+#define ROSTER_CACHE_VERSION 1
+
+static bool loadRosterCache(const QString &fileName, XMPP::Roster &roster)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_9);
+    quint32 magic;
+    quint16 version;
+    quint32 count;
+    in >> magic >> version >> count;
+    if (magic != ROSTER_CACHE_MAGIC || version != ROSTER_CACHE_VERSION)
+        return false;
+
+    roster.reserve(int(count));
+    QString     jid, name, subscription, ask;
+    QStringList groups;
+    while (count-- && in.status() == QDataStream::Ok) {
+        in >> jid >> name >> subscription >> ask >> groups;
+        RosterItem   ri;
+        Subscription s;
+        s.fromString(subscription);
+        ri.setJid(Jid(jid));
+        ri.setName(name);
+        ri.setSubscription(s);
+        ri.setAsk(ask);
+        ri.setGroups(groups);
+        roster += ri;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+static void saveRosterCache(const QString &fileName, const XMPP::Roster &roster)
+{
+    QDir().mkpath(QFileInfo(fileName).path());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("failed to save roster cache to %s", qPrintable(fileName));
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_9);
+    out << quint32(ROSTER_CACHE_MAGIC) << quint16(ROSTER_CACHE_VERSION) << quint32(roster.count());
+    for (const RosterItem &ri : roster) {
+        out << ri.jid().full() << ri.name() << ri.subscription().toString() << ri.ask() << ri.groups();
+    }
+    file.commit();
+}
+
+/**
+ * The roster is cached in a separate binary file to keep accounts.xml small
+ */
+QString UserAccount::rosterCacheFile() const
+{
+    return pathToProfile(activeProfile, ApplicationInfo::CacheLocation) + "/roster-" + JIDUtil::encode(id).toLower()
+        + ".dat";
+}
+
 void UserAccount::fromOptions(OptionsTree *o, QString base)
 {
     // WARNING: If you add any new option here, only read the option if
@@ -244,7 +309,10 @@ void UserAccount::fromOptions(OptionsTree *o, QString base)
         allow_plain = XMPP::ClientStream::NoAllowPlain;
     }
 
+    // roster-cache options are left by older versions. they are dropped on the next save
     QStringList rosterCache = o->getChildOptionNames(base + ".roster-cache", true, true);
+    if (rosterCache.isEmpty() && !loadRosterCache(rosterCacheFile(), roster))
+        roster.clear();
     for (const QString &rbase : rosterCache) {
         RosterItem ri;
         ri.setJid(Jid(o->getOption(rbase + ".jid").toString()));
@@ -390,15 +458,7 @@ void UserAccount::toOptions(OptionsTree *o, QString base)
         qFatal("unknown allow_plain enum value in UserAccount::toOptions");
     }
 
-    int idx = 0;
-    for (const RosterItem &ri : qAsConst(roster)) {
-        QString rbase = base + ".roster-cache.a" + QString::number(idx++);
-        o->setOption(rbase + ".jid", ri.jid().full());
-        o->setOption(rbase + ".name", ri.name());
-        o->setOption(rbase + ".subscription", ri.subscription().toString());
-        o->setOption(rbase + ".ask", ri.ask());
-        o->setOption(rbase + ".groups", ri.groups());
-    }
+    saveRosterCache(rosterCacheFile(), roster);
 
     // now we check for redundant entries
     QStringList   groupList;
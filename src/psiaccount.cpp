@@ -39,6 +39,7 @@
 #include "alertable.h"
 #include "alertmanager.h"
 #include "applicationinfo.h"
+#include "atomicxmlfile/atomicxmlfile.h"
 #include "avatars.h"
 #include "avcall/avcall.h"
 #include "avcall/calldlg.h"
@@ -75,6 +76,7 @@
 #include "jingle-session.h"
 #include "mood.h"
 #include "mooddlg.h"
+#include "mucjoinscheduler.h"
 #include "networkaccessmanager.h"
 #include "passdialog.h"
 #include "pepmanager.h"
@@ -85,6 +87,7 @@
 #include "popupmanager.h"
 #include "profiles.h"
 #include "proxy.h"
+#include "psicapsregsitry.h"
 #include "psicon.h"
 #include "psicontact.h"
 #include "psicontactlist.h"
@@ -139,9 +142,12 @@
 #endif
 
 #include <QApplication>
+#include <QDomDocument>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFrame>
+#include <QFuture>
 #include <QHostInfo>
 #include <QIcon>
 #include <QInputDialog>
@@ -156,12 +162,15 @@
 #include <QQueue>
 #include <QTimer>
 #include <QUrl>
+#include <QtConcurrentRun>
 #include <QtCrypto>
 #include <qca.h>
 #ifdef HAVE_KEYCHAIN
 #include <qt5keychain/keychain.h>
 #endif
 
+#include <algorithm>
+
 /*#ifdef Q_OS_WIN
 #    include <windows.h>
 typedef int socklen_t;
@@ -339,6 +348,9 @@ struct ReconnectData {
 };
 
 static const int RECONNECT_TIMEOUT_ERROR = -10;
+static const int PRESENCE_SLICE          = 20;   // ms of the event loop given to queued presences at once
+static const int PRESENCE_SOUND_INTERVAL = 1000; // ms between online/offline sounds
+static const int PRESENCE_QUEUE_CHECK    = 500;  // ms to wait for queued presences before enabling notifications
 
 static QList<ReconnectData> reconnectData()
 {
@@ -375,6 +387,10 @@ public:
         updateOnlineContactsCountTimer_->setSingleShot(true);
         connect(updateOnlineContactsCountTimer_, &QTimer::timeout, this, &Private::updateOnlineContactsCountTimeout);
 
+        presenceTimer = new QTimer(this);
+        presenceTimer->setSingleShot(true);
+        connect(presenceTimer, &QTimer::timeout, this, &Private::applyPresences);
+
         logoutTimer = new QTimer(this);
         logoutTimer->setInterval(1000);
         logoutTimer->setSingleShot(true);
@@ -415,6 +431,25 @@ public:
     QTimer                  *updateOnlineContactsCountTimer_ = nullptr;
     QTimer                  *logoutTimer                     = nullptr;
 
+    // Event queue persistence
+    QTimer       *queueSaveTimer = nullptr;
+    QFuture<void> queueSaveFuture;
+
+    // Initial presence flood
+    struct QueuedPresence {
+        Jid      jid;
+        Resource resource;
+        bool     available;
+    };
+    QQueue<QueuedPresence> presenceQueue;
+    QTimer                *presenceTimer = nullptr;
+    QElapsedTimer          loginTimer;
+    qint64                 presencesAppliedAt = 0; // ms since login when the queue was drained last time
+    int                    bulkPresences      = 0;
+    bool                   presenceBulkMode   = false;
+    QElapsedTimer          onlineSoundPlayed;
+    QElapsedTimer          offlineSoundPlayed;
+
     // Tune
     Tune lastTune;
 
@@ -451,7 +486,8 @@ public:
     PEPManager *pepManager = nullptr;
 
     // Bookmarks
-    BookmarkManager *bookmarkManager = nullptr;
+    BookmarkManager * bookmarkManager  = nullptr;
+    MucJoinScheduler *mucJoinScheduler = nullptr;
 
     // HttpAuth
     HttpAuthManager *httpAuthManager = nullptr;
@@ -665,8 +701,114 @@ public:
             contact->startAnim();
     }
 
+    void startPresenceBulkMode()
+    {
+        clearPresenceQueue();
+        loginTimer.start();
+        presencesAppliedAt = 0;
+        bulkPresences      = 0;
+        presenceBulkMode   = true;
+    }
+
+    void stopPresenceBulkMode()
+    {
+        if (!presenceBulkMode)
+            return;
+        presenceBulkMode = false;
+        if (bulkPresences)
+            qDebug("PsiAccount: %s: %d initial presences for %d contacts applied in %lld ms after login",
+                   qUtf8Printable(jid.bare()), bulkPresences, userList.count(), presencesAppliedAt);
+    }
+
+    void clearPresenceQueue()
+    {
+        presenceQueue.clear();
+        presenceTimer->stop();
+    }
+
 public slots:
-    void queueChanged() { eventQueue->toFile(pathToProfileEvents()); }
+    // presences received while logging in are applied in time slices, so the UI stays responsive.
+    // Queued presences are applied after stanzas received later, so a contact with an open chat
+    // bypasses the queue to keep its status in order with its messages.
+    void queueResourceAvailable(const Jid &j, const Resource &r) { queuePresence(j, r, true); }
+
+    void queueResourceUnavailable(const Jid &j, const Resource &r) { queuePresence(j, r, false); }
+
+    void queuePresence(const Jid &j, const Resource &r, bool available)
+    {
+        bool direct = !presenceBulkMode && presenceQueue.isEmpty();
+        if (!direct && account->findChatDialog(j, false)) {
+            // older presences of this resource must not overwrite this one later
+            presenceQueue.erase(std::remove_if(presenceQueue.begin(), presenceQueue.end(),
+                                               [&j](const QueuedPresence &p) { return p.jid.compare(j); }),
+                                presenceQueue.end());
+            direct = true;
+        }
+        if (direct) {
+            if (available)
+                account->client_resourceAvailable(j, r);
+            else
+                account->client_resourceUnavailable(j, r);
+            return;
+        }
+
+        presenceQueue.enqueue({ j, r, available });
+        if (presenceBulkMode)
+            ++bulkPresences;
+        if (!presenceTimer->isActive())
+            presenceTimer->start();
+    }
+
+    void applyPresences()
+    {
+        QElapsedTimer slice;
+        slice.start();
+        // the contact list is updated once per slice
+        emit account->beginBulkContactUpdate();
+        while (!presenceQueue.isEmpty() && !slice.hasExpired(PRESENCE_SLICE)) {
+            QueuedPresence p = presenceQueue.dequeue();
+            if (p.available)
+                account->client_resourceAvailable(p.jid, p.resource);
+            else
+                account->client_resourceUnavailable(p.jid, p.resource);
+        }
+        emit account->endBulkContactUpdate();
+
+        if (!presenceQueue.isEmpty())
+            presenceTimer->start();
+        else if (presenceBulkMode)
+            presencesAppliedAt = loginTimer.elapsed();
+    }
+
+    // a burst of events (e.g. offline messages) is saved with one snapshot
+    void queueChanged()
+    {
+        if (!queueSaveTimer->isActive())
+            queueSaveTimer->start();
+    }
+
+    // the document is built here, but serialized and written in background
+    void saveQueue()
+    {
+        if (queueSaveFuture.isRunning()) {
+            queueSaveTimer->start(); // previous snapshot is still being written
+            return;
+        }
+
+        QDomDocument doc;
+        doc.appendChild(eventQueue->toXml(&doc));
+        QString fname   = pathToProfileEvents();
+        queueSaveFuture = QtConcurrent::run([doc, fname]() { AtomicXmlFile(fname).saveDocument(doc); });
+    }
+
+    void flushQueue()
+    {
+        queueSaveFuture.waitForFinished();
+        if (queueSaveTimer->isActive()) {
+            queueSaveTimer->stop();
+            eventQueue->toFile(pathToProfileEvents());
+        }
+    }
 
     void loadQueue()
     {
@@ -1039,7 +1181,11 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
     d->loginStatus = Status(Status::Offline);
     d->setManualStatus(Status(Status::Offline, "", 0));
 
-    d->eventQueue = new EventQueue(this);
+    d->eventQueue     = new EventQueue(this);
+    d->queueSaveTimer = new QTimer(d);
+    d->queueSaveTimer->setSingleShot(true);
+    d->queueSaveTimer->setInterval(1000);
+    connect(d->queueSaveTimer, &QTimer::timeout, d, &Private::saveQueue);
     connect(d->eventQueue, &EventQueue::queueChanged, this, &PsiAccount::queueChanged);
     connect(d->eventQueue, &EventQueue::queueChanged, d, &Private::queueChanged);
     connect(d->eventQueue, &EventQueue::eventFromXml, this, &PsiAccount::eventFromXml);
@@ -1087,8 +1233,8 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
     connect(d->client, &Client::rosterItemAdded, this, &PsiAccount::client_rosterItemUpdated);
     connect(d->client, &Client::rosterItemUpdated, this, &PsiAccount::client_rosterItemUpdated);
     connect(d->client, &Client::rosterItemRemoved, this, &PsiAccount::client_rosterItemRemoved);
-    connect(d->client, &Client::resourceAvailable, this, &PsiAccount::client_resourceAvailable);
-    connect(d->client, &Client::resourceUnavailable, this, &PsiAccount::client_resourceUnavailable);
+    connect(d->client, &Client::resourceAvailable, d, &Private::queueResourceAvailable);
+    connect(d->client, &Client::resourceUnavailable, d, &Private::queueResourceUnavailable);
     connect(d->client, &Client::presenceError, this, &PsiAccount::client_presenceError);
     connect(d->client, &Client::messageReceived, this, &PsiAccount::client_messageReceived);
     connect(d->client, &Client::subscription, this, &PsiAccount::client_subscription);
@@ -1151,6 +1297,16 @@ PsiAccount::PsiAccount(const UserAccount &acc, PsiContactList *parent, TabManage
     // Bookmarks
     d->bookmarkManager = new BookmarkManager(this);
     connect(d->bookmarkManager, &BookmarkManager::availabilityChanged, this, &PsiAccount::bookmarksAvailabilityChanged);
+#ifdef GROUPCHAT
+    d->mucJoinScheduler = new MucJoinScheduler(d->psi, this);
+    connect(d->mucJoinScheduler, &MucJoinScheduler::joinRequested, this, [this](const ConferenceBookmark &c) {
+        if (findDialog<GCMainDlg *>(c.jid().withResource(QString())))
+            d->mucJoinScheduler->joined(c.jid()); // joined manually meanwhile
+        else
+            actionJoin(c, true, false);
+    });
+    connect(this, &PsiAccount::disconnected, d->mucJoinScheduler, &MucJoinScheduler::clear);
+#endif
 
 #ifdef USE_PEP
     // Tune Controller
@@ -1268,6 +1424,7 @@ PsiAccount::~PsiAccount()
     delete d->client;
     delete d->httpAuthManager;
     cleanupStream();
+    d->flushQueue();
     delete d->eventQueue;
     delete d->avatarFactory;
 
@@ -1662,6 +1819,7 @@ void PsiAccount::login()
     notifyOnlineOk  = false;
     rosterDone      = false;
     presenceSent    = false;
+    d->startPresenceBulkMode();
 
     stateChanged();
 
@@ -2451,7 +2609,7 @@ void PsiAccount::bookmarksAvailabilityChanged()
             auto ul = findRelevant(Jid(QString(), cj.domain()));
             if (ul.isEmpty() || !ul[0]->isTransport()
                 || !ul[0]->resourceList().isEmpty()) { // don't join to MUCs on disconnected transports
-                actionJoin(c, true, false);
+                d->mucJoinScheduler->enqueue(c);
             }
         }
     }
@@ -2605,7 +2763,7 @@ void PsiAccount::client_resourceAvailable(const Jid &j, const Resource &r)
                 Jid cj = c.jid().withResource(QString());
                 if (u->jid().domain() == cj.domain() && !findDialog<GCMainDlg *>(cj) && c.needJoin()) {
                     // now join MUCs on connected transport
-                    actionJoin(c, true, false);
+                    d->mucJoinScheduler->enqueue(c);
                 }
             }
         }
@@ -2648,6 +2806,8 @@ void PsiAccount::client_resourceAvailable(const Jid &j, const Resource &r)
     // This has to happen after the userlist item has been created.
     if (r.status().caps().isValid()) {
         CapsManager *cm = client()->capsManager();
+        if (auto registry = qobject_cast<PsiCapsRegistry *>(CapsRegistry::instance()))
+            registry->countLookup(j, r.status().caps());
 
         // Update the client version
         const auto &items = findRelevant(j);
@@ -3399,6 +3559,14 @@ void PsiAccount::playSound(PsiAccount::SoundType _onevent)
         && (s == STATUS_AWAY || s == STATUS_XA))
         return;
 
+    // a burst of presences (e.g. contacts coming online after a server restart) plays its sound once
+    if (onevent == eOnline || onevent == eOffline) {
+        QElapsedTimer &played = onevent == eOnline ? d->onlineSoundPlayed : d->offlineSoundPlayed;
+        if (played.isValid() && !played.hasExpired(PRESENCE_SOUND_INTERVAL))
+            return;
+        played.start();
+    }
+
     d->psi->playSound(str);
 }
 
@@ -3721,6 +3889,10 @@ void PsiAccount::simulateRosterOffline()
 {
     emit beginBulkContactUpdate();
 
+    // presences still waiting in the queue are outdated now
+    d->clearPresenceQueue();
+    d->stopPresenceBulkMode();
+
     notifyOnlineOk = false;
     for (UserListItem *u : qAsConst(d->userList))
         simulateContactOffline(u);
@@ -3748,11 +3920,16 @@ bool PsiAccount::notifyOnline() const { return notifyOnlineOk; }
 
 void PsiAccount::enableNotifyOnline()
 {
-    if (d->userCounter > 1) {
+    if (!d->presenceQueue.isEmpty()) {
+        // the rest of the initial presences must not pop up
+        QTimer::singleShot(PRESENCE_QUEUE_CHECK, this, SLOT(enableNotifyOnline()));
+    } else if (d->userCounter > 1) {
         QTimer::singleShot(15000, this, SLOT(enableNotifyOnline()));
         d->userCounter = 0;
-    } else
+    } else {
         notifyOnlineOk = true;
+        d->stopPresenceBulkMode();
+    }
 }
 
 void PsiAccount::itemRetracted(const Jid &j, const QString &n, const PubSubRetraction &item)
@@ -5806,6 +5983,8 @@ void PsiAccount::client_groupChatJoined(const Jid &j)
 #ifdef GROUPCHAT
     // d->client->groupChatSetStatus(j.host(), j.user(), d->loginStatus);
 
+    d->mucJoinScheduler->joined(j);
+
     GCMainDlg *m = findDialog<GCMainDlg *>(Jid(j.bare()));
     if (m) {
         m->setPassword(d->client->groupChatPassword(j.domain(), j.node()));
@@ -5892,6 +6071,8 @@ void PsiAccount::client_groupChatPresence(const Jid &j, const Status &s)
 void PsiAccount::client_groupChatError(const Jid &j, int code, const QString &str)
 {
 #ifdef GROUPCHAT
+    d->mucJoinScheduler->failed(j);
+
     GCMainDlg *w = findDialog<GCMainDlg *>(Jid(j.bare()));
     if (w) {
         w->error(code, str);
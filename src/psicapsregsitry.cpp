@@ -3,26 +3,110 @@
 #include "applicationinfo.h"
 #include "iodeviceopener.h"
 
-PsiCapsRegistry::PsiCapsRegistry(QObject *parent) : CapsRegistry(parent) { }
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtConcurrentRun>
 
-void PsiCapsRegistry::saveData(const QByteArray &data)
+#define CAPS_SAVE_DELAY 5000 // ms
+
+static void writeCaps(const QString &fileName, const QByteArray &data)
 {
-    QFile          file(ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml");
-    IODeviceOpener opener(&file, QIODevice::WriteOnly);
-    if (!opener.isOpen()) {
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
         qWarning("Caps: Unable to open IO device");
         return;
     }
     file.write(data);
+    file.commit();
+}
+
+PsiCapsRegistry::PsiCapsRegistry(QObject *parent) :
+    CapsRegistry(parent), fileName_(ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml")
+{
+    saveTimer_ = new QTimer(this);
+    saveTimer_->setSingleShot(true);
+    saveTimer_->setInterval(CAPS_SAVE_DELAY);
+    connect(saveTimer_, &QTimer::timeout, this, &PsiCapsRegistry::saveScheduled);
+}
+
+PsiCapsRegistry::~PsiCapsRegistry()
+{
+    qDebug("Caps: %d lookups, %d misses", lookups_, misses_);
+    saveFuture_.waitForFinished();
+    if (saveTimer_->isActive()) {
+        saveTimer_->stop();
+        async_ = false;
+        save();
+    }
+}
+
+/**
+ * Saves the registry a few seconds later, so a burst of new caps
+ * (e.g. on joining a big room) is written only once
+ */
+void PsiCapsRegistry::scheduleSave()
+{
+    if (!saveTimer_->isActive())
+        saveTimer_->start();
+}
+
+/**
+ * Counts a caps lookup for a roster or MUC presence. It has to be called
+ * while handling the presence, before a disco#info reply for unknown caps
+ * could be registered, so those count as misses. Repeated presences of a
+ * jid with the same caps are not counted again.
+ */
+void PsiCapsRegistry::countLookup(const XMPP::Jid &jid, const XMPP::CapsSpec &caps)
+{
+    const QString spec = caps.flatten();
+    QString &     last = lookedUp_[jid.full()];
+    if (last == spec)
+        return;
+    last = spec;
+    ++lookups_;
+    if (!isRegistered(spec))
+        ++misses_;
+}
+
+void PsiCapsRegistry::saveScheduled()
+{
+    if (lookups_)
+        qDebug("Caps: %d lookups, %d misses (%.1f%% hits)", lookups_, misses_,
+               100.0 * (lookups_ - misses_) / lookups_);
+    if (saveFuture_.isRunning()) {
+        saveTimer_->start(); // previous snapshot is still being written
+        return;
+    }
+    save();
+}
+
+// the registry is serialized here, but written in background
+void PsiCapsRegistry::saveData(const QByteArray &data)
+{
+    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    if (hash == savedHash_)
+        return;
+    savedHash_ = hash;
+
+    if (async_) {
+        saveFuture_ = QtConcurrent::run([fileName = fileName_, data]() { writeCaps(fileName, data); });
+    } else {
+        saveFuture_.waitForFinished();
+        writeCaps(fileName_, data);
+    }
 }
 
 QByteArray PsiCapsRegistry::loadData()
 {
-    QFile file(ApplicationInfo::homeDir(ApplicationInfo::CacheLocation) + "/caps.xml");
+    QFile file(fileName_);
     if (file.exists()) {
         IODeviceOpener opener(&file, QIODevice::ReadOnly);
         if (opener.isOpen()) {
-            return file.readAll();
+            QByteArray data = file.readAll();
+            savedHash_      = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+            return data;
         } else {
             qWarning("CapsRegistry: Cannot open input device");
         }
@@ -3,14 +3,40 @@
 
 #include "xmpp_caps.h"
 
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+
+class QTimer;
+
 class PsiCapsRegistry : public XMPP::CapsRegistry {
     Q_OBJECT
 
 public:
     PsiCapsRegistry(QObject *parent = nullptr);
+    ~PsiCapsRegistry();
 
     void       saveData(const QByteArray &data);
     QByteArray loadData();
+    void       countLookup(const XMPP::Jid &jid, const XMPP::CapsSpec &caps);
+
+public slots:
+    void scheduleSave();
+
+private slots:
+    void saveScheduled();
+
+private:
+    QString       fileName_;
+    QTimer *      saveTimer_;
+    QFuture<void> saveFuture_;
+    QByteArray    savedHash_;
+    bool          async_ = true;
+
+    // hit rate of the cache: caps looked up vs. caps which were not registered yet
+    QHash<QString, QString> lookedUp_; // full jid => flattened caps
+    int                     lookups_ = 0;
+    int                     misses_  = 0;
 };
 
 #endif // PSICAPSREGSITRY_H
@@ -85,6 +85,7 @@
 #include "tunecontrollermanager.h"
 #include "urlobject.h"
 #include "userlist.h"
+#include "vcardfactory.h"
 #ifdef HAVE_WEBSERVER
 #include "webserver.h"
 #endif
@@ -359,10 +360,9 @@ PsiCon::PsiCon() : QObject(nullptr)
 
     d->defaultMenuBar = new QMenuBar(nullptr);
 
-    XMPP::CapsRegistry::setInstance(new PsiCapsRegistry(this));
-    XMPP::CapsRegistry *pcr = XMPP::CapsRegistry::instance();
-    connect(pcr, SIGNAL(destroyed(QObject *)), pcr, SLOT(save()));
-    connect(pcr, SIGNAL(registered(const XMPP::CapsSpec &)), pcr, SLOT(save()));
+    PsiCapsRegistry *pcr = new PsiCapsRegistry(this);
+    XMPP::CapsRegistry::setInstance(pcr);
+    connect(pcr, SIGNAL(registered(const XMPP::CapsSpec &)), pcr, SLOT(scheduleSave()));
     pcr->load();
 }
 
@@ -395,6 +395,9 @@ bool PsiCon::init()
     PGPUtil::instance();
 #endif
 
+    // load the vCard index (and migrate the old cache) while the rest is initialized
+    VCardFactory::instance()->openStore();
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
     if (QGuiApplication::desktopFileName().isEmpty()) {
         QGuiApplication::setDesktopFileName(ApplicationInfo::desktopFileBaseName());
@@ -27,6 +27,7 @@
 #include "psioptions.h"
 #include "xmpp_serverinfomanager.h"
 
+#include <QFile>
 #include <QTimer>
 
 /**
@@ -208,6 +209,7 @@ void PsiContactList::removeAccount(PsiAccount *account)
 {
     emit accountRemoved(account);
     account->deleteQueueFile();
+    QFile::remove(account->accountOptions().rosterCacheFile());
     delete account;
     emit saveAccounts();
 }
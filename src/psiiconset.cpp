@@ -24,9 +24,11 @@
 #include "common.h"
 #include "psievent.h"
 #include "psioptions.h"
+#include "textutil.h"
 #include "userlist.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QSet>
 #include <QStandardPaths>
@@ -449,6 +451,7 @@ void PsiIconset::loadEmoticons()
         qDeleteAll(emoticons);
         emoticons.clear();
         emoticons = d->emoticons();
+        TextUtil::setEmoticons(emoticons);
 
         d->cur_emoticons = cur_emoticons;
         emit emoticonsChanged();
@@ -659,6 +662,10 @@ void PsiIconset::loadStatusIconDefinitions()
 
 bool PsiIconset::loadAll()
 {
+    QElapsedTimer timer;
+    timer.start();
+
+    Iconset::setDecodedIconsLimit(PsiOptions::instance()->getOption("options.iconsets.decoded-cache-size").toInt());
     if (!loadSystem() || !loadRoster())
         return false;
 
@@ -668,6 +675,8 @@ bool PsiIconset::loadAll()
     loadClients();
     loadAffiliations();
     loadStatusIconDefinitions();
+
+    qDebug("PsiIconset::loadAll(): iconsets loaded in %lld ms", timer.elapsed());
     return true;
 }
 
@@ -685,6 +694,8 @@ void PsiIconset::optionChanged(const QString &option)
         loadClients();
     } else if (option == "options.iconsets.affiliations") {
         loadAffiliations();
+    } else if (option == "options.iconsets.decoded-cache-size") {
+        Iconset::setDecodedIconsLimit(PsiOptions::instance()->getOption(option).toInt());
     } else if (option == "options.ui.contactlist.use-transport-icons") {
         d->status_icons.useServicesIcons
             = PsiOptions::instance()->getOption("options.ui.contactlist.use-transport-icons").toBool();
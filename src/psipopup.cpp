@@ -292,10 +292,9 @@ void PsiPopup::setData(const Jid &j, const Resource &r, const UserListItem *u, c
         name = "<nobr>&lt;" + TextUtil::escape(jid) + "&gt;</nobr>";
 
     QString statusString = TextUtil::plain2rich(status);
-    if (PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool())
-        statusString = TextUtil::emoticonify(statusString);
-    if (PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool())
-        statusString = TextUtil::legacyFormat(statusString);
+    statusString = TextUtil::formatMessage(
+        statusString, PsiOptions::instance()->getOption("options.ui.emoticons.use-emoticons").toBool(),
+        PsiOptions::instance()->getOption("options.ui.chat.legacy-formatting").toBool());
 
     if (!statusString.isEmpty())
         statusString = "<br>" + statusString;
@@ -29,13 +29,21 @@
 #include "xmpp_xdata.h"
 #include "xmpp_xmlcommon.h"
 
+#include <QAbstractTableModel>
 #include <QDomElement>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QPointer>
 
+#include <algorithm>
+
 using namespace XMPP;
 
+#define RSM_NS "http://jabber.org/protocol/rsm"
+
+// number of results requested at once and shown before "Load More" is pressed
+#define SEARCH_PAGE_SIZE 200
+
 //----------------------------------------------------------------------------
 // JT_XSearch
 //----------------------------------------------------------------------------
@@ -45,7 +53,7 @@ class JT_XSearch : public JT_Search {
 public:
     JT_XSearch(Task *parent);
 
-    void setForm(const Form &frm, const XData &_form);
+    void setForm(const Form &frm, const XData &_form, const QString &after = QString());
 
     bool        take(const QDomElement &);
     QDomElement iq() const;
@@ -67,7 +75,7 @@ bool JT_XSearch::take(const QDomElement &x)
 
 QDomElement JT_XSearch::iq() const { return _iq; }
 
-void JT_XSearch::setForm(const Form &frm, const XData &_form)
+void JT_XSearch::setForm(const Form &frm, const XData &_form, const QString &after)
 {
     JT_Search::set(frm);
 
@@ -78,6 +86,13 @@ void JT_XSearch::setForm(const Form &frm, const XData &_form)
     XData form(_form);
     form.setType(XData::Data_Submit);
     query.appendChild(form.toXml(doc()));
+
+    // ask for one page of results (XEP-0059)
+    QDomElement set = doc()->createElementNS(RSM_NS, "set");
+    set.appendChild(textTag(doc(), "max", QString::number(SEARCH_PAGE_SIZE)));
+    if (!after.isEmpty())
+        set.appendChild(textTag(doc(), "after", after));
+    query.appendChild(set);
 }
 
 void JT_XSearch::onGo()
@@ -88,6 +103,172 @@ void JT_XSearch::onGo()
         JT_Search::onGo();
 }
 
+//----------------------------------------------------------------------------
+// SearchResultsModel
+//----------------------------------------------------------------------------
+
+// Flat storage of search results. Only the first limit() rows are shown.
+class SearchResultsModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    SearchResultsModel(QObject *parent) : QAbstractTableModel(parent) { }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : qMin(totalRows(), limit_);
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        return parent.isValid() ? 0 : headers_.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const
+    {
+        if (!index.isValid() || role != Qt::DisplayRole)
+            return QVariant();
+        return text(index.row(), index.column());
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section >= headers_.size())
+            return QVariant();
+        return headers_.at(section);
+    }
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder)
+    {
+        if (column != sortColumn_) {
+            sortColumn_ = column;
+            updateKeys(0);
+        }
+        sortOrder_ = order;
+        sortRows();
+    }
+
+    QString text(int row, int column) const
+    {
+        if (column < 0 || column >= headers_.size())
+            return QString();
+        return cells_.at(row * headers_.size() + column);
+    }
+
+    int  totalRows() const { return headers_.isEmpty() ? 0 : cells_.size() / headers_.size(); }
+    bool hasHiddenRows() const { return totalRows() > limit_; }
+
+    void setHeaders(const QStringList &headers)
+    {
+        beginResetModel();
+        headers_ = headers;
+        cells_.clear();
+        keys_.clear();
+        limit_ = SEARCH_PAGE_SIZE;
+        endResetModel();
+    }
+
+    void clear() { setHeaders(headers_); }
+
+    // each row must have a cell for every column
+    void appendRows(const QVector<QStringList> &rows)
+    {
+        if (rows.isEmpty() || headers_.isEmpty())
+            return;
+
+        int first = rowCount();
+        int last  = qMin(totalRows() + rows.size(), limit_) - 1;
+        if (last >= first)
+            beginInsertRows(QModelIndex(), first, last);
+
+        int start = totalRows();
+        cells_.reserve(cells_.size() + rows.size() * headers_.size());
+        for (const QStringList &row : rows) {
+            for (int i = 0; i < headers_.size(); ++i) {
+                cells_ += row.value(i);
+            }
+        }
+        updateKeys(start);
+
+        if (last >= first)
+            endInsertRows();
+
+        if (sortColumn_ >= 0)
+            sortRows();
+    }
+
+    void showMore()
+    {
+        int first = rowCount();
+        int last  = qMin(totalRows(), limit_ + SEARCH_PAGE_SIZE) - 1;
+        if (last >= first)
+            beginInsertRows(QModelIndex(), first, last);
+        limit_ += SEARCH_PAGE_SIZE;
+        if (last >= first)
+            endInsertRows();
+    }
+
+private:
+    // cache case-folded sort keys of the rows starting from \a from
+    void updateKeys(int from)
+    {
+        if (sortColumn_ < 0 || sortColumn_ >= headers_.size()) {
+            keys_.clear();
+            return;
+        }
+
+        keys_.resize(totalRows());
+        for (int row = from; row < keys_.size(); ++row) {
+            keys_[row] = text(row, sortColumn_).toCaseFolded();
+        }
+    }
+
+    void sortRows()
+    {
+        if (keys_.size() != totalRows())
+            return;
+
+        const int    columns = headers_.size();
+        QVector<int> order(totalRows()); // new row => old row
+        for (int i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return sortOrder_ == Qt::AscendingOrder ? keys_.at(a) < keys_.at(b) : keys_.at(b) < keys_.at(a);
+        });
+
+        emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+        QVector<QString> cells(cells_.size());
+        QVector<QString> keys(keys_.size());
+        QVector<int>     newRow(order.size()); // old row => new row
+        for (int i = 0; i < order.size(); ++i) {
+            newRow[order[i]] = i;
+            keys[i]          = keys_.at(order[i]);
+            std::copy(cells_.cbegin() + order[i] * columns, cells_.cbegin() + (order[i] + 1) * columns,
+                      cells.begin() + i * columns);
+        }
+        cells_.swap(cells);
+        keys_.swap(keys);
+
+        const QModelIndexList from = persistentIndexList();
+        QModelIndexList       to;
+        for (const QModelIndex &index : from) {
+            int row = newRow.value(index.row(), -1);
+            to += row >= 0 && row < limit_ ? this->index(row, index.column()) : QModelIndex();
+        }
+        changePersistentIndexList(from, to);
+
+        emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    }
+
+    QStringList      headers_;
+    QVector<QString> cells_; // row by row
+    QVector<QString> keys_;  // sort key of each row
+    int              limit_      = SEARCH_PAGE_SIZE;
+    int              sortColumn_ = -1;
+    Qt::SortOrder    sortOrder_  = Qt::AscendingOrder;
+};
+
 //----------------------------------------------------------------------------
 // SearchDlg
 //----------------------------------------------------------------------------
@@ -125,11 +306,11 @@ public:
             }
         }
 
-        const auto &items = dlg->lv_results->selectedItems();
-        for (QTreeWidgetItem *i : items) {
+        const auto &rows = dlg->lv_results->selectionModel()->selectedRows();
+        for (const QModelIndex &i : rows) {
             NickAndJid nickJid;
-            nickJid.jid  = XMPP::Jid(i->text(jid));
-            nickJid.nick = i->text(nick);
+            nickJid.jid  = XMPP::Jid(results->text(i.row(), jid));
+            nickJid.nick = results->text(i.row(), nick);
             result << nickJid;
         }
 
@@ -151,6 +332,10 @@ public:
     XDataWidget *      xdata = nullptr;
     XData              xdata_form;
     QScrollArea *      scrollArea = nullptr;
+
+    SearchResultsModel *results = nullptr;
+    XData               submitted; // x:data form of the last search, to request the next page
+    QString             rsmLast;   // RSM id of the last received result, empty if no more pages
 };
 
 SearchDlg::SearchDlg(const Jid &jid, PsiAccount *pa) : QDialog(nullptr)
@@ -182,9 +367,20 @@ SearchDlg::SearchDlg(const Jid &jid, PsiAccount *pa) : QDialog(nullptr)
     pb_info->setEnabled(false);
     pb_stop->setEnabled(false);
     pb_search->setEnabled(false);
-
-    connect(lv_results, SIGNAL(itemSelectionChanged()), SLOT(selectionChanged()));
-    connect(lv_results, SIGNAL(itemActivated(QTreeWidgetItem *, int)), SLOT(itemActivated(QTreeWidgetItem *, int)));
+    pb_more->setEnabled(false);
+
+    d->results = new SearchResultsModel(this);
+    d->results->setHeaders(QStringList() << QCoreApplication::translate("Search", "Nickname")
+                                         << QCoreApplication::translate("Search", "First Name")
+                                         << QCoreApplication::translate("Search", "Last Name")
+                                         << QCoreApplication::translate("Search", "E-Mail Address")
+                                         << QCoreApplication::translate("Search", "XMPP Address"));
+    lv_results->setModel(d->results);
+
+    connect(lv_results->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+            SLOT(selectionChanged()));
+    connect(lv_results, SIGNAL(activated(QModelIndex)), SLOT(itemActivated(QModelIndex)));
+    connect(pb_more, SIGNAL(clicked()), SLOT(doMore()));
     connect(pb_close, SIGNAL(clicked()), SLOT(close()));
     connect(pb_search, SIGNAL(clicked()), SLOT(doSearchSet()));
     connect(pb_stop, SIGNAL(clicked()), SLOT(doStop()));
@@ -226,17 +422,6 @@ SearchDlg::~SearchDlg()
     }
 }*/
 
-void SearchDlg::addEntry(const QString &jid, const QString &nick, const QString &first, const QString &last,
-                         const QString &email)
-{
-    QTreeWidgetItem *lvi = new QTreeWidgetItem(lv_results);
-    lvi->setText(0, nick);
-    lvi->setText(1, first);
-    lvi->setText(2, last);
-    lvi->setText(3, email);
-    lvi->setText(4, jid);
-}
-
 void SearchDlg::doSearchGet()
 {
     lb_instructions->setText(tr("<qt>Fetching search form for %1 ...</qt>").arg(d->jid.full()));
@@ -275,6 +460,7 @@ void SearchDlg::doSearchSet()
         form.setFields(d->xdata->fields());
 
         d->jt->setForm(d->form, form);
+        d->submitted = form;
     }
 
     clear();
@@ -363,6 +549,7 @@ void SearchDlg::jt_finished()
             qApp->processEvents();
             resize(sizeHint());
         } else {
+            bool firstPage = d->results->totalRows() == 0;
             lv_results->setUpdatesEnabled(false);
 
             if (!d->xdata) {
@@ -370,9 +557,12 @@ void SearchDlg::jt_finished()
                 if (list.isEmpty())
                     QMessageBox::information(this, tr("Search Results"), tr("Search returned 0 results."));
                 else {
+                    QVector<QStringList> rows;
+                    rows.reserve(list.size());
                     for (const auto &r : list) {
-                        addEntry(r.jid().full(), r.nick(), r.first(), r.last(), r.email());
+                        rows += QStringList() << r.nick() << r.first() << r.last() << r.email() << r.jid().full();
                     }
+                    d->results->appendRows(rows);
                 }
             } else {
                 XData    form;
@@ -388,33 +578,46 @@ void SearchDlg::jt_finished()
                     }
                 }
 
-                QStringList header_labels;
-                for (const XData::ReportField &report : form.report()) {
-                    header_labels << report.label;
+                if (firstPage) {
+                    QStringList header_labels;
+                    for (const XData::ReportField &report : form.report()) {
+                        header_labels << report.label;
+                    }
+                    d->results->setHeaders(header_labels);
+                    d->xdata_form = form;
                 }
 
-                lv_results->clear();
-                lv_results->setColumnCount(0);
-                lv_results->setHeaderLabels(header_labels);
-
+                QVector<QStringList> rows;
+                rows.reserve(form.reportItems().size());
                 for (XData::ReportItem ri : form.reportItems()) {
-                    int              i   = 0;
-                    QTreeWidgetItem *lvi = new QTreeWidgetItem(lv_results);
-                    for (const XData::ReportField &report : form.report()) {
-                        lvi->setText(i++, ri[report.name]);
+                    QStringList row;
+                    for (const XData::ReportField &report : d->xdata_form.report()) {
+                        row << ri[report.name];
                     }
+                    rows += row;
+                }
+                d->results->appendRows(rows);
+
+                // more pages on the server? (XEP-0059)
+                QDomElement set = queryTag(jt->iq()).firstChildElement("set");
+                d->rsmLast.clear();
+                if (set.namespaceURI() == RSM_NS && rows.size() > 0) {
+                    bool ok;
+                    int  count = set.firstChildElement("count").text().toInt(&ok);
+                    if (ok ? d->results->totalRows() < count : rows.size() >= SEARCH_PAGE_SIZE)
+                        d->rsmLast = set.firstChildElement("last").text();
                 }
-
-                d->xdata_form = form;
             }
 
-            for (int i = 0; i < lv_results->columnCount(); ++i) {
-                lv_results->resizeColumnToContents(i);
-                lv_results->setColumnWidth(i, qMin(lv_results->columnWidth(i), 300));
+            if (firstPage) {
+                for (int i = 0; i < d->results->columnCount(); ++i) {
+                    lv_results->resizeColumnToContents(i);
+                    lv_results->setColumnWidth(i, qMin(lv_results->columnWidth(i), 300));
+                }
+                lv_results->sortByColumn(0, Qt::AscendingOrder);
             }
-
-            lv_results->sortByColumn(0, Qt::AscendingOrder);
             lv_results->setUpdatesEnabled(true);
+            pb_more->setEnabled(d->results->hasHiddenRows() || !d->rsmLast.isEmpty());
         }
     } else {
         if (d->type == 0) {
@@ -430,9 +633,37 @@ void SearchDlg::jt_finished()
 
 void SearchDlg::clear()
 {
-    lv_results->clear();
+    d->results->clear();
+    d->rsmLast.clear();
     pb_add->setEnabled(false);
     pb_info->setEnabled(false);
+    pb_more->setEnabled(false);
+}
+
+void SearchDlg::doMore()
+{
+    // show the results received already first
+    if (d->results->hasHiddenRows()) {
+        d->results->showMore();
+        pb_more->setEnabled(d->results->hasHiddenRows() || !d->rsmLast.isEmpty());
+        return;
+    }
+
+    if (d->rsmLast.isEmpty() || d->busy->isActive() || !d->pa->checkConnected(this))
+        return;
+
+    d->jt = new JT_XSearch(d->pa->client()->rootTask());
+    d->jt->setForm(d->form, d->submitted, d->rsmLast);
+
+    pb_search->setEnabled(false);
+    pb_stop->setEnabled(true);
+    pb_more->setEnabled(false);
+    d->gr_form->setEnabled(false);
+    d->busy->start();
+
+    d->type = 1;
+    connect(d->jt, SIGNAL(finished()), SLOT(jt_finished()));
+    d->jt->go(true);
 }
 
 void SearchDlg::doStop()
@@ -451,15 +682,14 @@ void SearchDlg::doStop()
 
 void SearchDlg::selectionChanged()
 {
-    bool enable = !lv_results->selectedItems().isEmpty();
+    bool enable = lv_results->selectionModel()->hasSelection();
     pb_add->setEnabled(enable);
     pb_info->setEnabled(enable);
 }
 
-void SearchDlg::itemActivated(QTreeWidgetItem *item, int column)
+void SearchDlg::itemActivated(const QModelIndex &index)
 {
-    Q_UNUSED(item);
-    Q_UNUSED(column);
+    Q_UNUSED(index);
     doInfo();
 }
 
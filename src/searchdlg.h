@@ -47,9 +47,10 @@ private slots:
     void doSearchGet();
     void doSearchSet();
     void selectionChanged();
-    void itemActivated(QTreeWidgetItem *item, int column);
+    void itemActivated(const QModelIndex &index);
     void jt_finished();
     void doStop();
+    void doMore();
     void doAdd();
     void doInfo();
 
@@ -57,8 +58,6 @@ private:
     class Private;
     Private *d;
 
-    void addEntry(const QString &jid, const QString &nick, const QString &first, const QString &last,
-                  const QString &email);
     void clear();
 };
 
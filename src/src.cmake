@@ -179,7 +179,9 @@ list(APPEND HEADERS
     mucaffiliationsproxymodel.h
     mucaffiliationsview.h
     mucconfigdlg.h
+    muchighlighter.h
     mucjoindlg.h
+    mucjoinscheduler.h
     mucmanager.h
     mucreasonseditor.h
     multifiletransferdelegate.h
@@ -255,6 +257,7 @@ list(APPEND HEADERS
     varlist.h
     vcardfactory.h
     vcardphotodlg.h
+    vcardstore.h
     voicecalldlg.h
     voicecaller.h
     xdata_widget.h
@@ -426,7 +429,9 @@ list(APPEND SOURCES
     mucaffiliationsproxymodel.cpp
     mucaffiliationsview.cpp
     mucconfigdlg.cpp
+    muchighlighter.cpp
     mucjoindlg.cpp
+    mucjoinscheduler.cpp
     mucmanager.cpp
     mucreasonseditor.cpp
     multifiletransferdelegate.cpp
@@ -496,6 +501,7 @@ list(APPEND SOURCES
     varlist.cpp
     vcardfactory.cpp
     vcardphotodlg.cpp
+    vcardstore.cpp
     voicecalldlg.cpp
     xdata_widget.cpp
     xmlconsole.cpp
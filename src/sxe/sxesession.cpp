@@ -21,14 +21,33 @@
 
 #include "sxemanager.h"
 
+#include "psioptions.h"
+
+#include "QTextStream"
 #include "QTimer"
 #include "QUuid"
 
+#include <climits>
+
 using namespace XMPP;
 
 // The maxlength of a chdata that gets put in one edit
 enum { MAXCHDATA = 1024 };
 
+// How long outgoing edits are collected before they're sent in one <sxe/>
+enum { FLUSH_DELAY = 50 };
+
+// QDomNode is an implicitly shared handle. The address of the private node it
+// points to identifies the node regardless of which handle is used. The
+// protected member is reached through a pointer to member formed in a subclass,
+// which is valid for any QDomNode object.
+class SxeNodeKey : public QDomNode {
+public:
+    static const void *of(const QDomNode &node) { return node.*(&SxeNodeKey::impl); }
+};
+
+static const void *nodeKey(const QDomNode &node) { return SxeNodeKey::of(node); }
+
 //----------------------------------------------------------------------------
 // SxeSession
 //----------------------------------------------------------------------------
@@ -41,6 +60,11 @@ SxeSession::SxeSession(SxeManager *manager, const Jid &target, const QString &se
 
 {
     setUUIDPrefix();
+
+    flushTimer_ = new QTimer(this);
+    flushTimer_->setSingleShot(true);
+    flushTimer_->setInterval(FLUSH_DELAY);
+    connect(flushTimer_, &QTimer::timeout, this, &SxeSession::sendQueuedEdits);
 }
 
 SxeSession::~SxeSession()
@@ -48,6 +72,7 @@ SxeSession::~SxeSession()
     qDebug("destruct SxeSession");
     qDeleteAll(recordByNodeId_);
     recordByNodeId_.clear();
+    recordByNode_.clear();
     emit sessionEnded(this);
 }
 
@@ -62,10 +87,11 @@ void SxeSession::initializeDocument(const QDomDocument &doc)
     const auto &metas = recordByNodeId_.values();
     for (SxeRecord *meta : metas)
         meta->deleteLater();
-    // recordByNode_.clear();
+    recordByNode_.clear();
     recordByNodeId_.clear();
     queuedIncomingEdits_.clear();
     queuedOutgoingEdits_.clear();
+    queuedOutgoingSize_ = 0;
 
     // import prolog
     doc_.setContent(parseProlog(doc));
@@ -223,7 +249,7 @@ void SxeSession::stopQueueing()
     queueing_ = false;
 
     // Process queued elements
-    flush();
+    sendQueuedEdits();
 
     if (!queuedIncomingEdits_.isEmpty()) {
         while (!queuedIncomingEdits_.isEmpty()) {
@@ -253,7 +279,11 @@ void SxeSession::stopImporting()
     importing_ = false;
 }
 
-void SxeSession::endSession() { deleteLater(); }
+void SxeSession::endSession()
+{
+    sendQueuedEdits();
+    deleteLater();
+}
 
 const QDomNode SxeSession::insertNodeBefore(const QDomNode &node, const QDomNode &parent, const QDomNode &referenceNode)
 {
@@ -466,21 +496,39 @@ void SxeSession::setNodeValue(const QDomNode &node, const QString &value, int fr
 
 void SxeSession::flush()
 {
+    // edits made in quick succession (e.g. while drawing) are sent together
+    if (!queuedOutgoingEdits_.isEmpty() && !flushTimer_->isActive())
+        flushTimer_->start();
+}
+
+void SxeSession::sendQueuedEdits()
+{
+    flushTimer_->stop();
     if (queuedOutgoingEdits_.isEmpty())
         return;
 
-    // create the sxe element
-    QDomDocument *doc = static_cast<SxeManager *>(parent())->client()->doc();
-    QDomElement   sxe = doc->createElementNS(SXENS, "sxe");
-    sxe.setAttribute("session", session_);
+    int maxPayload = PsiOptions::instance()->getOption("options.sxe.max-payload").toInt();
+    if (maxPayload <= 0)
+        maxPayload = INT_MAX;
 
-    // append all queued edits
+    QDomDocument *doc = static_cast<SxeManager *>(parent())->client()->doc();
     while (!queuedOutgoingEdits_.isEmpty()) {
-        sxe.appendChild(queuedOutgoingEdits_.takeFirst());
-    }
+        // create the sxe element
+        QDomElement sxe = doc->createElementNS(SXENS, "sxe");
+        sxe.setAttribute("session", session_);
+
+        // append as many queued edits as fit in one element, but at least one
+        int size = 0;
+        do {
+            OutgoingEdit edit = queuedOutgoingEdits_.takeFirst();
+            sxe.appendChild(edit.xml);
+            size += edit.size;
+        } while (!queuedOutgoingEdits_.isEmpty() && size + queuedOutgoingEdits_.first().size <= maxPayload);
+        queuedOutgoingSize_ -= size;
 
-    // pass the bundle to SxeManager
-    emit newSxeElement(sxe, target(), groupChat_);
+        // pass the bundle to SxeManager
+        emit newSxeElement(sxe, target(), groupChat_);
+    }
 }
 
 QDomNode SxeSession::generateNewNode(const QDomNode node, const QString &parent, double primaryWeight)
@@ -647,10 +695,12 @@ void SxeSession::reposition(const QDomNode &node, bool remote)
     }
 }
 
-// void SxeSession::addToLookup(const QDomNode &node, bool, const QString &rid) {
-// recordByNode_[node]
-//     = recordByNodeId_[rid];
-// }
+void SxeSession::addToLookup(const QDomNode &node, bool, const QString &rid)
+{
+    SxeRecord *meta = recordByNodeId_.value(rid);
+    if (meta)
+        recordByNode_[nodeKey(node)] = meta;
+}
 
 void SxeSession::handleNodeToBeAdded(const QDomNode &node, bool remote)
 {
@@ -674,14 +724,9 @@ void SxeSession::handleNodeToBeRemoved(const QDomNode &node, bool remote)
 
 void SxeSession::removeRecord(const QDomNode &node)
 {
-    QMutableHashIterator<QString, SxeRecord *> i(recordByNodeId_);
-
-    while (i.hasNext()) {
-        if (node == i.next().value()->node()) {
-            i.remove();
-            return;
-        }
-    }
+    SxeRecord *meta = recordByNode_.take(nodeKey(node));
+    if (meta)
+        recordByNodeId_.remove(meta->rid());
 }
 
 bool SxeSession::removeSmaller(SxeRecord *meta1, SxeRecord *meta2)
@@ -710,7 +755,22 @@ void SxeSession::queueOutgoingEdit(SxeEdit *edit)
 {
     if (!importing_) {
         QDomElement el = edit->xml(doc_);
-        queuedOutgoingEdits_.append(static_cast<SxeManager *>(parent())->client()->doc()->importNode(el, true));
+
+        OutgoingEdit outgoing;
+        outgoing.xml = static_cast<SxeManager *>(parent())->client()->doc()->importNode(el, true);
+        QString     str;
+        QTextStream ts(&str);
+        el.save(ts, 0);
+        ts.flush();
+        outgoing.size = str.size();
+
+        queuedOutgoingEdits_.append(outgoing);
+        queuedOutgoingSize_ += outgoing.size;
+
+        // don't let a long burst of edits grow into an oversized message
+        int maxPayload = PsiOptions::instance()->getOption("options.sxe.max-payload").toInt();
+        if (maxPayload > 0 && queuedOutgoingSize_ >= maxPayload)
+            sendQueuedEdits();
     }
 }
 
@@ -725,8 +785,8 @@ SxeRecord *SxeSession::createRecord(const QString &id)
     recordByNodeId_[id] = m;
 
     // once the node is actually created, add it to the lookup table
-    // connect(m, SIGNAL(nodeAdded(QDomNode, bool, QString)), SLOT(addToLookup(const QDomNode &, bool, const QString
-    // &)));
+    connect(m, SIGNAL(nodeToBeAdded(QDomNode, bool, QString)),
+            SLOT(addToLookup(const QDomNode &, bool, const QString &)));
 
     // remove the node in case of a conflicting edit
     connect(m, SIGNAL(nodeRemovalRequired(QDomNode)), SLOT(removeNode(QDomNode)));
@@ -749,13 +809,9 @@ SxeRecord *SxeSession::record(const QDomNode &node) const
     if (node.isNull())
         return nullptr;
 
-    // go through all the SxeRecord's
-    const auto &metas = recordByNodeId_.values();
-    for (SxeRecord *meta : metas) {
-        // qDebug() << QString("id: %1").arg(meta->rid()).toLatin1();
-        if (node == meta->node())
-            return meta;
-    }
+    SxeRecord *meta = recordByNode_.value(nodeKey(node));
+    if (meta && node == meta->node())
+        return meta;
 
     return nullptr;
 }
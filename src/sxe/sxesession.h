@@ -31,6 +31,7 @@
 #define SXENS "http://jabber.org/protocol/sxe"
 /*  ^^^^ make sure corresponds to NS used for parsing in iris/src/xmpp/xmpp-im/types.cpp ^^^^ */
 
+class QTimer;
 class SxeManager;
 
 namespace XMPP {
@@ -52,6 +53,10 @@ private:
         QString     id;
         QDomElement xml;
     };
+    struct OutgoingEdit {
+        QDomNode xml;
+        int      size;
+    };
 
 public:
     /*! \brief Constructor.
@@ -134,7 +139,9 @@ public slots:
     /*! \brief Sets the value of \a node to \a value. */
     void setNodeValue(const QDomNode &node, const QString &value, int from = -1, int n = 0);
 
-    /*! \brief Sends all queued edits.*/
+    /*! \brief Schedules sending of all queued edits.
+     *  Edits queued within a short interval are sent together.
+     */
     void flush();
 
 signals:
@@ -177,7 +184,9 @@ private slots:
     /*! \brief Remove the record entry from the lookup tables and emit the appropriate public signals. */
     void handleNodeToBeRemoved(const QDomNode &node, bool remote);
     /*! \brief Add a node node to the lookup table. */
-    // void addToLookup(const QDomNode &node, bool, const QString &rid);
+    void addToLookup(const QDomNode &node, bool, const QString &rid);
+    /*! \brief Sends all queued edits now, split into elements of at most options.sxe.max-payload. */
+    void sendQueuedEdits();
 
 private:
     /*! \brief Inserts or moves a node according to it's record (parent and primary-weight). */
@@ -223,10 +232,16 @@ private:
 
     /*! \brief Hash used for rid -> SxeRecord* lookups.*/
     QHash<QString, SxeRecord *> recordByNodeId_;
+    /*! \brief Hash used for node -> SxeRecord* lookups. Keyed by the node's private data.*/
+    QHash<const void *, SxeRecord *> recordByNode_;
     /*! \brief List of queued incoming sxe elements.*/
     QList<IncomingEdit> queuedIncomingEdits_;
     /*! \brief List of queued outgoing sxe elements.*/
-    QList<QDomNode> queuedOutgoingEdits_;
+    QList<OutgoingEdit> queuedOutgoingEdits_;
+    /*! \brief Total serialized size of the queued outgoing edits.*/
+    int queuedOutgoingSize_ = 0;
+    /*! \brief Delays sending of the queued outgoing edits.*/
+    QTimer *flushTimer_;
     /*! \brief QDomDocument representing the the contents when queueing_ was set true.*/
     QList<SxeEdit *> snapshot_;
     /*! \brief True if the target is a groupchat.*/
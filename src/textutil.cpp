@@ -3,11 +3,15 @@
 #include "coloropt.h"
 #include "common.h"
 #include "emojiregistry.h"
-#include "psiiconset.h"
+#include "iconset.h"
 #include "psioptions.h"
 #include "rtparse.h"
 
+#include <QHash>
 #include <QTextDocument> // for escape()
+#include <QVector>
+
+#include <algorithm>
 
 // With Qt4 this func was more complex. Now we don't need it
 QString TextUtil::escape(const QString &plain) { return plain.toHtmlEscaped(); }
@@ -497,89 +501,152 @@ QString TextUtil::linkify(const QString &in)
     return out;
 }
 
-// sickening
-QString TextUtil::emoticonify(const QString &in)
+namespace {
+struct EmoticonText {
+    QString  text;
+    PsiIcon *icon;
+};
+
+// first character => emoticon texts starting with it, longest first
+typedef QHash<QChar, QVector<EmoticonText>> EmoticonIndex;
+}
+
+static EmoticonIndex emoticonIndex;
+
+/**
+ * Sets emoticon iconsets used by emoticonify() and formatMessage().
+ * The icons are referenced until the next call, so it has to be called
+ * again before the iconsets are deleted.
+ */
+void TextUtil::setEmoticons(const QList<Iconset *> &emoticons)
+{
+    emoticonIndex.clear();
+    for (const Iconset *iconset : emoticons) {
+        QListIterator<PsiIcon *> it = iconset->iterator();
+        while (it.hasNext()) {
+            PsiIcon *icon = it.next();
+            for (const PsiIcon::IconText &t : icon->text()) {
+                if (!t.text.isEmpty())
+                    emoticonIndex[t.text.at(0)].append({ t.text, icon });
+            }
+        }
+    }
+    for (auto &list : emoticonIndex) {
+        std::stable_sort(list.begin(), list.end(), [](const EmoticonText &a, const EmoticonText &b) {
+            return a.text.length() > b.text.length();
+        });
+    }
+}
+
+// returns emoticon at position i of str which has whitespace at least on one side
+static const EmoticonText *matchEmoticon(const EmoticonIndex &index, const QString &str, int i)
+{
+    auto it = index.constFind(str.at(i));
+    if (it == index.constEnd())
+        return nullptr;
+
+    bool leftSpace = i == 0 || str.at(i - 1).isSpace();
+    for (const EmoticonText &e : it.value()) {
+        int end = i + e.text.length();
+        if (end > str.length() || str.midRef(i, e.text.length()) != e.text)
+            continue;
+        if (leftSpace || end == str.length() || str.at(end).isSpace())
+            return &e;
+    }
+    return nullptr;
+}
+
+static void putPlainText(RTParse &p, const QString &in, bool emoji)
+{
+    if (emoji)
+        emojiconifyPlainText(p, in);
+    else
+        p.putPlain(in);
+}
+
+// wraps words marked with one of markers keeping the markers. the inside of a marked
+// word is formatted with the other markers, so *_text_* is bold and underlined.
+// edges of the text count as word boundaries, like tags did for legacyFormat()
+static void formatWords(RTParse &p, const QString &in, bool emoji, const QString &markers)
 {
+    int done = 0;
+    int i    = 0;
+    while (i < in.length()) {
+        if (in.at(i).isSpace()) {
+            ++i;
+            continue;
+        }
+        int end = i;
+        while (end < in.length() && !in.at(end).isSpace())
+            ++end;
+
+        const QChar marker = in.at(i);
+        const char *tag    = marker == '_' ? "u" : marker == '*' ? "b" : marker == '/' ? "i" : nullptr;
+        if (tag && markers.contains(marker) && end - i > 2 && in.at(end - 1) == marker) {
+            putPlainText(p, in.mid(done, i - done), emoji);
+            p.putRich(QString("<%1>").arg(QLatin1String(tag)));
+            putPlainText(p, QString(marker), emoji);
+            formatWords(p, in.mid(i + 1, end - i - 2), emoji, QString(markers).remove(marker));
+            putPlainText(p, QString(marker), emoji);
+            p.putRich(QString("</%1>").arg(QLatin1String(tag)));
+            done = end;
+        }
+        i = end;
+    }
+    putPlainText(p, in.mid(done), emoji);
+}
+
+static void formatPlainText(RTParse &p, const QString &in, bool emoji, bool legacy)
+{
+    if (legacy)
+        formatWords(p, in, emoji, QStringLiteral("_*/"));
+    else
+        putPlainText(p, in, emoji);
+}
+
+/**
+ * Adds emoticons, emoji and legacy formatting to a richtext string.
+ * Same as emoticonify() followed by legacyFormat(), but the text chunks are
+ * walked once for both and emoticons are looked up by their first character.
+ * Unlike legacyFormat(), words marked twice like *_text_* get both formats.
+ * Links, shares and icon tags are still handled by separate passes.
+ */
+QString TextUtil::formatMessage(const QString &in, bool emoticons, bool legacy)
+{
+    if (!emoticons && !legacy)
+        return in;
+
+    const EmoticonIndex *index = emoticons ? &emoticonIndex : nullptr;
+
     RTParse p(in);
     while (!p.atEnd()) {
         // returns us the first chunk as a plaintext string
-        QString str = p.next();
-
-        int i = 0;
-        while (i >= 0) {
-            // find closest emoticon
-            int      ePos    = -1;
-            PsiIcon *closest = nullptr;
-
-            int foundPos = -1, foundLen = -1;
-
-            for (const Iconset *iconset : qAsConst(PsiIconset::instance()->emoticons)) {
-                QListIterator<PsiIcon *> it = iconset->iterator();
-                while (it.hasNext()) {
-                    PsiIcon *icon = it.next();
-                    if (icon->regExp().isEmpty())
-                        continue;
-
-                    // some hackery
-                    int  iii = i;
-                    bool searchAgain;
-
-                    // search the first occurance of the emoticon in the remaining text
-                    // which is surronded with at least one space
-                    do {
-                        searchAgain = false;
-
-                        // find the closest match
-                        const QRegExp &rx = icon->regExp();
-                        int            n  = rx.indexIn(str, iii);
-                        if (n == -1)
-                            continue;
-
-                        if (ePos == -1 || n < ePos || (rx.matchedLength() > foundLen && n < ePos + foundLen)) {
-                            bool leftSpace  = n == 0 || (n > 0 && str[n - 1].isSpace());
-                            bool rightSpace = (n + rx.matchedLength() == int(str.length()))
-                                || (n + rx.matchedLength() < int(str.length())
-                                    && str[n + rx.matchedLength()].isSpace());
-                            // there must be whitespace at least on one side of the emoticon
-                            if (leftSpace || rightSpace) {
-                                ePos    = n;
-                                closest = icon;
-
-                                foundPos = n;
-                                foundLen = rx.matchedLength();
-                                break;
-                            }
-
-                            searchAgain = true;
-                        }
-
-                        iii = n + rx.matchedLength();
-                    } while (searchAgain);
+        const QString str  = p.next();
+        int           done = 0;
+        if (index && !index->isEmpty()) {
+            int i = 0;
+            while (i < str.length()) {
+                const EmoticonText *e = matchEmoticon(*index, str, i);
+                if (!e) {
+                    ++i;
+                    continue;
                 }
+                formatPlainText(p, str.mid(done, i - done), emoticons, legacy);
+                p.putRich(QString("<icon name=\"%1\" text=\"%2\" size=\"%3\" type=\"smiley\">")
+                              .arg(TextUtil::escape(e->icon->name()), TextUtil::escape(e->text),
+                                   QString::number(-1.4)));
+                i += e->text.length();
+                done = i;
             }
-
-            QString s;
-            if (ePos == -1)
-                s = str.mid(i);
-            else
-                s = str.mid(i, ePos - i);
-            emojiconifyPlainText(p, s);
-            // p.putPlain(s);
-
-            if (!closest)
-                break;
-
-            p.putRich(QString("<icon name=\"%1\" text=\"%2\" size=\"%3\" type=\"smiley\">")
-                          .arg(TextUtil::escape(closest->name()), TextUtil::escape(str.mid(foundPos, foundLen)),
-                               QString::number(-1.4)));
-            i = foundPos + foundLen;
         }
+        formatPlainText(p, str.mid(done), emoticons, legacy);
     }
 
-    QString out = p.output();
-    return out;
+    return p.output();
 }
 
+QString TextUtil::emoticonify(const QString &in) { return formatMessage(in, true, false); }
+
 QString TextUtil::img2title(const QString &in)
 {
     QString ret = in;
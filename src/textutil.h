@@ -1,8 +1,9 @@
 #ifndef TEXTUTIL_H
 #define TEXTUTIL_H
 
-#include <QtGlobal>
+#include <QList>
 
+class Iconset;
 class QString;
 class QStringRef;
 
@@ -18,6 +19,8 @@ QString resolveEntities(const QStringRef &);
 QString linkify(const QString &);
 QString legacyFormat(const QString &);
 QString emoticonify(const QString &in);
+QString formatMessage(const QString &in, bool emoticons, bool legacy);
+void    setEmoticons(const QList<Iconset *> &emoticons);
 QString img2title(const QString &in);
 
 QString prepareMessageText(const QString &text, bool isEmote = false, bool isHtml = false);
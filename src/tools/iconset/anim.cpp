@@ -29,14 +29,18 @@
 #include <QThread>
 #include <QTimer>
 
+#include <memory>
+
 /**
  * \class Anim
  * \brief Class for handling animations
  *
  * Anim is a class that can load animations. Generally, it looks like
- * QMovie but it loads animations in one pass and stores it in memory.
+ * QMovie but it keeps decoded frames in memory once they were shown.
  *
- * Each frame of Anim is stored as Impix.
+ * Frames are decoded on demand: only the first one is decoded on
+ * construction, the rest are read from the source data when the animation
+ * reaches them. Each decoded frame of Anim is stored as Impix.
  */
 
 static QThread *animMainThread = nullptr;
@@ -61,8 +65,14 @@ public:
         int   period = 100;
     };
 
-    QList<Frame> frames;
-    int          frame;
+    mutable QList<Frame> frames;
+    int                  frame;
+
+    // source of not yet decoded frames. released when all frames are read
+    mutable QByteArray                    data;
+    mutable std::unique_ptr<QBuffer>      buffer;
+    mutable std::unique_ptr<QImageReader> reader;
+    mutable int                           totalFrames = 0;
 
 public:
     void init()
@@ -89,6 +99,8 @@ public:
     {
         init();
 
+        from.decodeAll(); // copies are rare, so don't bother with sharing the reader
+
         speed             = from.speed;
         lasttimerinterval = from.lasttimerinterval;
         looping           = from.looping;
@@ -96,6 +108,7 @@ public:
         frame             = from.frame;
         paused            = from.paused;
         frames            = from.frames;
+        totalFrames       = from.totalFrames;
 
         if (!paused)
             unpause();
@@ -105,25 +118,28 @@ public:
     {
         init();
 
-        QBuffer buffer(const_cast<QByteArray *>(ba));
-        buffer.open(QBuffer::ReadOnly);
-        QImageReader reader(&buffer);
-
-        while (reader.canRead()) {
-            QImage image = reader.read();
-            if (!image.isNull()) {
-                Frame newFrame;
-                newFrame.impix  = Impix(image);
-                newFrame.period = reader.nextImageDelay();
-                frames.append(newFrame);
-            } else {
-                break;
-            }
+        data = *ba;
+        buffer.reset(new QBuffer(&data));
+        buffer->open(QBuffer::ReadOnly);
+        reader.reset(new QImageReader(buffer.get()));
+
+        readFrame();
+        if (!reader) {
+            return;
         }
 
-        looping = reader.loopCount();
+        looping                = reader->loopCount();
+        bool supportsAnimation = reader->supportsAnimation();
+        if (!supportsAnimation) {
+            decodeAll();
+        } else {
+            totalFrames = reader->imageCount();
+            if (totalFrames <= frames.count()) {
+                decodeAll(); // the format can't tell the number of frames in advance
+            }
+        }
 
-        if (!reader.supportsAnimation() && (frames.count() == 1)) {
+        if (!supportsAnimation && frames.count() == 1) {
             QImage frame = frames[0].impix.image();
 
             // we're gonna slice the single image we've got if we're absolutely sure
@@ -139,12 +155,61 @@ public:
                     newFrames.append(newFrame);
                 }
 
-                frames  = newFrames;
-                looping = 0;
+                frames      = newFrames;
+                totalFrames = frames.count();
+                looping     = 0;
             }
         }
     }
 
+    // decodes one more frame. returns false when there are no more frames
+    bool readFrame() const
+    {
+        if (!reader) {
+            return false;
+        }
+
+        QImage image;
+        if (reader->canRead()) {
+            image = reader->read();
+        }
+        if (image.isNull()) {
+            releaseReader();
+            return false;
+        }
+
+        Frame newFrame;
+        newFrame.impix  = Impix(image);
+        newFrame.period = reader->nextImageDelay();
+        frames.append(newFrame);
+        return true;
+    }
+
+    void releaseReader() const
+    {
+        reader.reset();
+        buffer.reset();
+        data.clear();
+        totalFrames = frames.count();
+    }
+
+    void decodeAll() const
+    {
+        while (readFrame()) { }
+    }
+
+    bool ensureFrame(int n) const
+    {
+        while (n >= frames.count() && readFrame()) { }
+        return n < frames.count();
+    }
+
+    const Frame &frameAt(int n) const
+    {
+        ensureFrame(n);
+        return frames[qBound(0, n, frames.count() - 1)];
+    }
+
     ~Private()
     {
         if (frametimer)
@@ -170,12 +235,12 @@ public:
             restartTimer();
     }
 
-    int numFrames() const { return frames.count(); }
+    int numFrames() const { return reader ? totalFrames : frames.count(); }
 
     void restartTimer()
     {
         if (!paused && speed > 0) {
-            int frameperiod = frames[frame].period;
+            int frameperiod = frameAt(frame).period;
             int i           = frameperiod >= 0 ? frameperiod * 100 / speed : 0;
             if (i != lasttimerinterval || !frametimer->isActive()) {
                 lasttimerinterval = i;
@@ -193,7 +258,7 @@ public slots:
     void refresh()
     {
         frame++;
-        if (frame >= numFrames()) {
+        if (frame >= numFrames() || !ensureFrame(frame)) {
             frame = 0;
 
             loop++;
@@ -233,17 +298,17 @@ Anim::~Anim() { }
 /**
  * Returns QPixmap of current frame.
  */
-const QPixmap &Anim::framePixmap() const { return d->frames[d->frame].impix.pixmap(); }
+const QPixmap &Anim::framePixmap() const { return d->frameAt(d->frame).impix.pixmap(); }
 
 /**
  * Returns QImage of current frame.
  */
-const QImage &Anim::frameImage() const { return d->frames[d->frame].impix.image(); }
+const QImage &Anim::frameImage() const { return d->frameAt(d->frame).impix.image(); }
 
 /**
  * Returns Impix of current frame.
  */
-const Impix &Anim::frameImpix() const { return d->frames[d->frame].impix; }
+const Impix &Anim::frameImpix() const { return d->frameAt(d->frame).impix; }
 
 /**
  * Returns total number of frames in animation.
@@ -258,7 +323,7 @@ int Anim::frameNumber() const { return d->frame; }
 /**
  * Returns Impix of animation frame number \a n.
  */
-const Impix &Anim::frame(int n) const { return d->frames[n].impix; }
+const Impix &Anim::frame(int n) const { return d->frameAt(n).impix; }
 
 /**
  * Returns \c true if numFrames() == 0 and \c false otherwise.
@@ -355,8 +420,10 @@ void Anim::detach() { d.detach(); }
 void Anim::stripFirstFrame()
 {
     detach();
+    d->decodeAll();
     if (numFrames() > 1) {
         d->frames.takeFirst();
+        d->totalFrames = d->frames.count();
 
         if (!paused())
             restart();
@@ -42,16 +42,23 @@
 #include <QFileInfo>
 #include <QIcon>
 #include <QIconEngine>
+#include <QImageReader>
 #include <QLocale>
+#include <QMutex>
 #include <QObject>
 #include <QPainter>
 #include <QRegExp>
+#include <QSet>
 #include <QSharedData>
 #include <QSharedDataPointer>
 #include <QSvgRenderer>
 #include <QTextCodec>
 #include <QThread>
 #include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #ifdef ICONSET_SOUND
 #include <QDataStream>
 #include <qca_basic.h>
@@ -222,6 +229,59 @@ private:
 
 static IconSharedObject *iconSharedObject = nullptr;
 
+//----------------------------------------------------------------------------
+// DecodedIconsCache
+//----------------------------------------------------------------------------
+
+// Keeps track of the icons decoded on demand and unloads the least recently
+// used ones when there are too many of them. Unloaded icons are decoded again
+// from their raw data on the next access.
+class DecodedIconsCache : public QObject {
+    Q_OBJECT
+public:
+    static DecodedIconsCache *instance()
+    {
+        if (!instance_) {
+            instance_ = new DecodedIconsCache();
+        }
+        return instance_;
+    }
+
+    void add(PsiIcon::Private *icon);
+    void remove(PsiIcon::Private *icon);
+
+    quint64 nextUsage() { return ++usageCounter_; }
+
+    int  limit() const { return limit_; }
+    void setLimit(int limit);
+
+private slots:
+    void trim();
+
+private:
+    DecodedIconsCache()
+    {
+        // trimming is always done in the main thread, where icons are used
+        if (QCoreApplication::instance()) {
+            moveToThread(QCoreApplication::instance()->thread());
+        }
+    }
+
+    static DecodedIconsCache *instance_;
+
+    QMutex                   mutex_;
+    QSet<PsiIcon::Private *> icons_;
+    std::atomic<quint64>     usageCounter_ { 0 };
+    int                      limit_         = 1024;
+    bool                     trimScheduled_ = false;
+};
+
+DecodedIconsCache *DecodedIconsCache::instance_ = nullptr;
+
+// serializes lazy decoding with unloading in DecodedIconsCache::trim(), so an icon
+// is never decoded twice or unloaded halfway. must be locked before DecodedIconsCache::mutex_
+static QMutex iconDecodeMutex;
+
 //----------------------------------------------------------------------------
 // PsiIcon
 //----------------------------------------------------------------------------
@@ -253,6 +313,9 @@ public:
 
     ~Private()
     {
+        if (cached) {
+            DecodedIconsCache::instance()->remove(this);
+        }
         anim.reset();
         if (icon) {
             delete icon;
@@ -264,18 +327,26 @@ public:
     {
         moveToMainThread(this);
 
-        name        = from.name;
-        mime        = from.mime;
-        regExp      = from.regExp;
-        text        = from.text;
-        sound       = from.sound;
-        impix       = from.impix;
-        rawData     = from.rawData;
-        scalable    = from.scalable;
-        svgRenderer = from.svgRenderer;
+        name            = from.name;
+        mime            = from.mime;
+        regExp          = from.regExp;
+        text            = from.text;
+        sound           = from.sound;
+        impix           = from.impix;
+        rawData         = from.rawData;
+        scalable        = from.scalable;
+        svgRenderer     = from.svgRenderer;
+        decodePending   = from.decodePending.load();
+        decodeAnim      = from.decodeAnim;
+        stripFirstFrame = from.stripFirstFrame;
         anim.reset(from.anim ? new Anim(*from.anim) : nullptr);
         icon           = nullptr;
         activatedCount = from.activatedCount;
+
+        if (from.cached) {
+            cached = true;
+            DecodedIconsCache::instance()->add(this);
+        }
     }
 
     void connectInstance(PsiIcon *icon)
@@ -290,6 +361,86 @@ public:
         disconnect(this, SIGNAL(iconModified()), icon, SIGNAL(iconModified()));
     }
 
+    // decodes rawData if it wasn't done yet. see PsiIcon::loadFromData()
+    Private *decoded()
+    {
+        if (decodePending.load(std::memory_order_acquire)) {
+            QMutexLocker locker(&iconDecodeMutex);
+            if (decodePending.load(std::memory_order_relaxed)) {
+                decode();
+                decodePending.store(false, std::memory_order_release);
+                if (!cached) {
+                    cached = true;
+                    DecodedIconsCache::instance()->add(this);
+                }
+            }
+        }
+        if (cached) {
+            lastUsed = DecodedIconsCache::instance()->nextUsage();
+        }
+        return this;
+    }
+
+    void decode()
+    {
+        if (scalable) {
+            svgRenderer = std::make_shared<QSvgRenderer>(rawData);
+            if (!svgRenderer->isValid()) {
+                svgRenderer.reset();
+            }
+        }
+        if (svgRenderer) {
+            return;
+        }
+
+        bool ok = false;
+        if (decodeAnim) {
+            Anim a(rawData);
+            if (a.numFrames() > 0) {
+                impix = a.frame(0);
+                ok    = true;
+            }
+            if (a.numFrames() > 1) {
+                anim.reset(new Anim(a));
+                if (stripFirstFrame) {
+                    anim->stripFirstFrame();
+                }
+            }
+        }
+
+        if (!ok) {
+            impix.loadFromData(rawData);
+        }
+    }
+
+    // frees decoded data which could be restored from rawData later
+    bool unload()
+    {
+        if (decodePending || activatedCount > 0) {
+            return false;
+        }
+
+        impix = Impix();
+        anim.reset();
+        svgRenderer.reset();
+        if (icon) {
+            delete icon;
+            icon = nullptr;
+        }
+        decodePending = true;
+        return true;
+    }
+
+    // the icon data was set directly, so there is nothing to decode later
+    void dropRawSource()
+    {
+        decodePending = false;
+        if (cached) {
+            cached = false;
+            DecodedIconsCache::instance()->remove(this);
+        }
+    }
+
 signals:
     void pixmapChanged();
     void iconModified();
@@ -330,11 +481,76 @@ public:
     mutable QByteArray            rawData;
     bool                          scalable = false;
 
+    std::atomic_bool decodePending { false }; // rawData is not decoded yet
+    bool             decodeAnim      = false; // rawData may contain an animation
+    bool             stripFirstFrame = false; // strip the first animation frame after decoding
+    bool             cached          = false; // registered in DecodedIconsCache
+    quint64          lastUsed        = 0;
+
     int activatedCount = 0;
     friend class PsiIcon;
 };
 //! \endif
 
+void DecodedIconsCache::add(PsiIcon::Private *icon)
+{
+    QMutexLocker locker(&mutex_);
+    icons_.insert(icon);
+    if (icons_.count() > limit_ && !trimScheduled_) {
+        trimScheduled_ = true;
+        // icons may be referenced by the caller right now. so trim later
+        QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+    }
+}
+
+void DecodedIconsCache::remove(PsiIcon::Private *icon)
+{
+    QMutexLocker locker(&mutex_);
+    icons_.remove(icon);
+}
+
+void DecodedIconsCache::setLimit(int limit)
+{
+    QMutexLocker locker(&mutex_);
+    limit_ = limit;
+    if (icons_.count() > limit_ && !trimScheduled_) {
+        trimScheduled_ = true;
+        QMetaObject::invokeMethod(this, "trim", Qt::QueuedConnection);
+    }
+}
+
+void DecodedIconsCache::trim()
+{
+    QMutexLocker decodeLocker(&iconDecodeMutex);
+    QMutexLocker locker(&mutex_);
+    trimScheduled_ = false;
+    if (icons_.count() <= limit_) {
+        return;
+    }
+
+    // unload the oldest quarter at once, so we don't sort on each new icon
+    auto icons = icons_.values();
+    std::sort(icons.begin(), icons.end(),
+              [](const PsiIcon::Private *a, const PsiIcon::Private *b) { return a->lastUsed < b->lastUsed; });
+    int toUnload = icons.count() - limit_ + limit_ / 4;
+    for (PsiIcon::Private *icon : qAsConst(icons)) {
+        if (toUnload <= 0) {
+            break;
+        }
+        if (icon->unload()) {
+            icon->cached = false;
+            icons_.remove(icon);
+            toUnload--;
+        }
+    }
+}
+
+// returns icon's data, decoding it first if it wasn't done yet
+static inline PsiIcon::Private *decodedData(const QSharedDataPointer<PsiIcon::Private> &d)
+{
+    return const_cast<PsiIcon::Private *>(d.constData())->decoded();
+}
+
 /**
  * Constructs empty PsiIcon.
  */
@@ -389,52 +605,63 @@ void PsiIcon::detach() { d.detach(); }
 /**
  * Returns \c true when icon contains animation.
  */
-bool PsiIcon::isAnimated() const { return d->anim != nullptr; }
+bool PsiIcon::isAnimated() const
+{
+    return decodedData(d)->anim != nullptr;
+}
 
 /**
  * Returns QPixmap of current frame.
  */
-QPixmap PsiIcon::pixmap(const QSize &desiredSize) const { return d->pixmap(desiredSize); }
+QPixmap PsiIcon::pixmap(const QSize &desiredSize) const
+{
+    return decodedData(d)->pixmap(desiredSize);
+}
 
 /**
  * Returns QImage of current frame.
  */
 QImage PsiIcon::image(const QSize &desiredSize) const
 {
-    if (d->anim) {
-        return d->anim->frameImage();
+    const Private *p = decodedData(d);
+    if (p->anim) {
+        return p->anim->frameImage();
     }
 
-    auto img = d->impix.image();
-    if (d->svgRenderer) {
-        QSize sz = d->svgRenderer->defaultSize().scaled(desiredSize, Qt::KeepAspectRatio);
+    auto img = p->impix.image();
+    if (p->svgRenderer) {
+        QSize sz = p->svgRenderer->defaultSize().scaled(desiredSize, Qt::KeepAspectRatio);
         if (!img.isNull() && img.size() == sz)
             return img;
         img = QImage(sz, QImage::Format_ARGB32_Premultiplied);
         img.fill(Qt::transparent);
-        QPainter p(&img);
-        d->svgRenderer->render(&p);
+        QPainter painter(&img);
+        p->svgRenderer->render(&painter);
         // d->impix.setImage(img); // we need some mutable member to chache this.
     }
     return img;
 }
 
 /**
- * Returns Impix of first animation frame.
+ * Returns Impix of first animation frame. It's a copy, since decoded data may be unloaded at any time.
  * \sa setImpix()
  */
-const Impix &PsiIcon::impix() const { return d->impix; }
+Impix PsiIcon::impix() const
+{
+    return decodedData(d)->impix;
+}
 
 /**
  * Returns Impix of current animation frame.
  * \sa impix()
  */
-const Impix &PsiIcon::frameImpix() const
+Impix PsiIcon::frameImpix() const
 {
-    if (d->anim) {
-        return d->anim->frameImpix();
+    const Private *p = decodedData(d);
+    if (p->anim) {
+        return p->anim->frameImpix();
     }
-    return d->impix;
+    return p->impix;
 }
 
 /**
@@ -443,16 +670,17 @@ const Impix &PsiIcon::frameImpix() const
  */
 QIcon PsiIcon::icon() const
 {
-    if (d->icon) {
-        return *d->icon;
+    Private *p = decodedData(d);
+    if (p->icon) {
+        return *p->icon;
     }
 
-    if (d->svgRenderer) {
-        auto eng = new SvgIconEngine(d->name, d->svgRenderer);
+    if (p->svgRenderer) {
+        auto eng = new SvgIconEngine(p->name, p->svgRenderer);
         return QIcon(eng);
     }
-    const_cast<Private *>(d.data())->icon = new QIcon(d->impix.pixmap());
-    return *d->icon;
+    p->icon = new QIcon(p->impix.pixmap());
+    return *p->icon;
 }
 
 /**
@@ -473,8 +701,9 @@ const QByteArray &PsiIcon::raw() const
 
 QSize PsiIcon::size(const QSize &desiredSize) const
 {
-    if (d->scalable) {
-        QSize origSize = d->svgRenderer ? d->svgRenderer->defaultSize() : d->impix.size();
+    const Private *p = decodedData(d);
+    if (p->scalable) {
+        QSize origSize = p->svgRenderer ? p->svgRenderer->defaultSize() : p->impix.size();
         if (!desiredSize.width() && !desiredSize.height())
             return origSize;
         if (!desiredSize.width()) {
@@ -485,7 +714,7 @@ QSize PsiIcon::size(const QSize &desiredSize) const
         }
         return origSize.scaled(desiredSize, Qt::KeepAspectRatio);
     }
-    return d->impix.size();
+    return p->impix.size();
 }
 
 bool PsiIcon::isScalable() const { return d->scalable; }
@@ -502,6 +731,7 @@ void PsiIcon::setImpix(const Impix &impix, bool doDetach)
         detach();
     }
 
+    d->dropRawSource();
     d->impix = impix;
     if (d->icon) {
         delete d->icon;
@@ -515,7 +745,10 @@ void PsiIcon::setImpix(const Impix &impix, bool doDetach)
 /**
  * Returns pointer to Anim object, or \a 0 if PsiIcon doesn't contain an animation.
  */
-const Anim *PsiIcon::anim() const { return d->anim.get(); }
+const Anim *PsiIcon::anim() const
+{
+    return decodedData(d)->anim.get();
+}
 
 /**
  * Sets the animation for icon to \a anim. Also sets Impix to be the first frame of animation.
@@ -528,6 +761,7 @@ void PsiIcon::setAnim(const Anim &anim, bool doDetach)
         detach();
     }
 
+    d->dropRawSource();
     d->anim.reset(new Anim(anim));
 
     if (d->anim->numFrames() > 0) {
@@ -557,6 +791,8 @@ void PsiIcon::removeAnim(bool doDetach)
         detach();
     }
 
+    d->decoded();
+    d->decodeAnim = false;
     if (!d->anim) {
         return;
     }
@@ -702,6 +938,10 @@ bool PsiIcon::blockSignals(bool b) { return d->blockSignals(b); }
 /**
  * Initializes PsiIcon's Impix (or Anim, if \a isAnim equals \c true).
  * Iconset::load uses this function.
+ *
+ * Only the image header is checked here, the actual decoding is postponed
+ * until the image is requested for the first time. Decoded data may be
+ * unloaded later when it was not used for a long time.
  */
 bool PsiIcon::loadFromData(const QString &mime, const QByteArray &ba, bool isAnim, bool isScalable)
 {
@@ -709,37 +949,41 @@ bool PsiIcon::loadFromData(const QString &mime, const QByteArray &ba, bool isAni
     if (ba.isEmpty())
         return ret;
 
-    detach();
-    d->rawData     = ba;
-    d->scalable    = isScalable;
-    d->svgRenderer = nullptr;
-    if (d->scalable) {
-        d->svgRenderer = std::make_shared<QSvgRenderer>(ba);
-        if (!d->svgRenderer->isValid()) {
-            d->svgRenderer.reset();
-            d->svgRenderer = nullptr;
-        }
-    }
-    if (d->svgRenderer) {
-        ret = true;
+    if (isScalable) {
+        ret = true; // svg is validated on decoding, then it falls back to raster formats
     } else {
-        if (isAnim) {
-            Anim *anim = new Anim(ba);
-            setAnim(*anim);
-            ret = anim->numFrames() > 0;
-            delete anim; // shared data rules ;)
-        }
+        QBuffer buffer(const_cast<QByteArray *>(&ba));
+        buffer.open(QIODevice::ReadOnly);
+        ret = QImageReader(&buffer).canRead();
+    }
+    if (!ret) {
+        return ret;
+    }
 
-        if (!ret && d->impix.loadFromData(ba))
-            ret = true;
+    detach();
+    d->dropRawSource();
+    d->rawData  = ba;
+    d->scalable = isScalable;
+    d->svgRenderer.reset();
+    d->anim.reset();
+    d->impix = Impix();
+    if (d->icon) {
+        delete d->icon;
+        d->icon = nullptr;
     }
+    d->decodeAnim      = isAnim;
+    d->decodePending   = true;
+    d->stripFirstFrame = false;
+    d->mime            = mime;
 
-    if (ret) {
-        d->mime = mime;
-        emit d->pixmapChanged();
-        emit d->iconModified();
+    if (isAnim && d->activatedCount > 0) {
+        d->activatedCount = 0;
+        activated(false); // restart the animation, but don't play the sound
     }
 
+    emit d->pixmapChanged();
+    emit d->iconModified();
+
     return ret;
 }
 
@@ -769,6 +1013,7 @@ void PsiIcon::activated(bool playSound)
     Q_UNUSED(iconSharedObject);
 #endif
 
+    d->decoded();
     if (d->anim) {
         d->anim->unpause();
 
@@ -805,9 +1050,10 @@ void PsiIcon::stripFirstAnimFrame()
 {
     detach();
 
-    if (d->anim) {
+    if (!d->decodePending && d->anim) {
         d->anim->stripFirstFrame();
     }
+    d->stripFirstFrame = true; // remember it in case the icon is decoded again
 }
 
 //----------------------------------------------------------------------------
@@ -1030,13 +1276,15 @@ private:
     }
 
 public:
-    QString                    id, name, version, description, creation, homeUrl, filename;
-    QStringList                authors;
-    QHash<QString, PsiIcon *>  dict; // unsorted hash for fast search
-    QList<PsiIcon *>           list; // sorted list
-    QHash<QString, QString>    info;
-    int                        iconSize_;
-    QHash<QString, QByteArray> zipCache;
+    QString                   id, name, version, description, creation, homeUrl, filename;
+    QStringList               authors;
+    QHash<QString, PsiIcon *> dict; // unsorted hash for fast search
+    QList<PsiIcon *>          list; // sorted list
+    QHash<QString, QString>   info;
+    int                       iconSize_;
+#ifdef ICONSET_ZIP
+    std::unique_ptr<UnZip> zip; // opened while the iconset is loading
+#endif
 
 public:
     Private() { init(); }
@@ -1104,10 +1352,16 @@ public:
         }
 #ifdef ICONSET_ZIP
         else { // else its zip or jisp file
-            UnZip z(dir);
-            if (zipCache.isEmpty())
-                zipCache = z.unpackAll();
-            ba = zipCache.value(fi.completeBaseName() + '/' + fileName);
+            // read only requested members instead of unpacking the whole archive
+            if (!zip) {
+                zip.reset(new UnZip(dir));
+                if (!zip->open()) {
+                    qWarning("%s can't be opened", qPrintable(dir));
+                    zip.reset();
+                    return ba;
+                }
+            }
+            zip->readFile(fi.completeBaseName() + '/' + fileName, &ba);
         }
 #endif
 
@@ -1236,7 +1490,11 @@ public:
             // regexp = QString("(\\b(%1))|((%2)\\b)").arg(regexp).arg(regexp);
             icon.setRegExp(QRegExp(regexp.join("|")));
         }
-        size = icon.size();
+        // don't decode the image just to know its size
+        size = QImageReader(finfo.filePath()).size();
+        if (!size.isValid()) {
+            size = icon.size();
+        }
 
         icon.blockSignals(false);
 
@@ -1632,7 +1890,9 @@ bool Iconset::load(const QString &dir, Format format)
                    "Failed to load icondef.xml");
         qWarning("Iconset::load(\"%s\"): Failed to load icondef.xml", qPrintable(dir));
     }
-    d->zipCache.clear();
+#ifdef ICONSET_ZIP
+    d->zip.reset();
+#endif
 
     // QPixmap::setDefaultOptimization( optimization );
 
@@ -1810,4 +2070,17 @@ void Iconset::setSoundPrefs(QString unpackPath, QObject *receiver, const char *s
 #endif
 }
 
+/**
+ * Sets the maximum number of icons which are kept decoded in memory. Icons are
+ * decoded on first use, and the least recently used ones are unloaded when
+ * there are more than \a limit of them. Unloaded icons are decoded again from
+ * their original data when needed.
+ */
+void Iconset::setDecodedIconsLimit(int limit)
+{
+    if (limit > 0) {
+        DecodedIconsCache::instance()->setLimit(limit);
+    }
+}
+
 #include "iconset.moc"
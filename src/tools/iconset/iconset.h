@@ -123,9 +123,9 @@ public:
     bool              isScalable() const;
     const QString &   mimeType() const;
 
-    virtual const Impix &impix() const;
-    virtual const Impix &frameImpix() const;
-    void                 setImpix(const Impix &, bool doDetach = true);
+    virtual Impix impix() const;
+    virtual Impix frameImpix() const;
+    void          setImpix(const Impix &, bool doDetach = true);
 
     const Anim *anim() const;
     void        setAnim(const Anim &, bool doDetach = true);
@@ -225,6 +225,7 @@ public:
 
     static bool isSourceAllowed(const QFileInfo &fi);
     static void setSoundPrefs(QString unpackPath, QObject *receiver, const char *slot);
+    static void setDecodedIconsLimit(int limit);
 
     Iconset copy() const;
     void    detach();
@@ -0,0 +1,184 @@
+#include "emojiregistry.h"
+
+#include <QtTest/QtTest>
+
+#include <map>
+#include <set>
+
+// EmojiRegistry as it was before the two-level lookup table: the code points are
+// searched in ranges built from the first code point of each emoji, the same way
+// admin/emoji.py builds them. findEmoji() is a verbatim copy of the old one.
+class ReferenceRegistry {
+public:
+    using Category = EmojiRegistry::Category;
+
+    ReferenceRegistry()
+    {
+        std::set<quint32> codes;
+        for (const EmojiRegistry::Emoji &e : EmojiRegistry::instance())
+            codes.insert(e.code.toUcs4().value(0));
+
+        quint32 start = 0, last = 0;
+        for (quint32 code : codes) {
+            if (start && code != last + 1) {
+                ranges_[start] = last;
+                start          = 0;
+            }
+            if (!start)
+                start = code;
+            last = code;
+        }
+        ranges_[start] = last;
+    }
+
+    Category startCategory(QStringRef in) const
+    {
+        if (in.isEmpty())
+            return Category::None;
+        quint32 ucs;
+        if (in[0].isHighSurrogate()) {
+            if (in.length() == 1)
+                return Category::None;
+            ucs = QChar::surrogateToUcs4(in[0], in[1]);
+        } else {
+            ucs = in[0].unicode();
+            if (ucs < 256 && (in.length() == 1 || in[1].unicode() != 0xfe0f)) {
+                return Category::None;
+            }
+        }
+        if (ucs == 0x200d)
+            return Category::ZWJ;
+        if (ucs == 0xfe0f)
+            return Category::FullQualify;
+        if (ucs <= 0x39 && in.length() > 2 && (ucs >= 0x30 || ucs == 0x2a || ucs == 0x23)
+            && in[1].unicode() == 0xfe0f && in[2].unicode() == 0x20e3)
+            return Category::SimpleKeycap;
+
+        bool found = false;
+        auto lb    = ranges_.lower_bound(ucs);
+        if (lb == ranges_.end() || lb->first != ucs) {
+            if (lb != ranges_.begin()) {
+                --lb;
+                found = (ucs > lb->first && ucs <= lb->second);
+            }
+        } else
+            found = lb->first == ucs;
+        if (found) {
+            if (ucs >= 0x1f3fb && ucs <= 0x1f3ff)
+                return Category::SkinTone;
+            return Category::Emoji;
+        }
+        return Category::None;
+    }
+
+    QStringRef findEmoji(const QString &in, int idx) const
+    {
+        int emojiStart = -1;
+
+        bool gotEmoji = false;
+        bool gotSkin  = false;
+        bool gotFQ    = false;
+        for (; idx < in.size(); idx++) {
+            auto category = startCategory(QStringRef(&in, idx, in.size() - idx));
+            if (gotEmoji && category != Category::None) {
+                if (category == Category::ZWJ) {
+                    gotEmoji = false;
+                    gotSkin  = false;
+                    gotFQ    = false;
+                } else if (category == Category::FullQualify) {
+                    if (gotFQ)
+                        break;
+                    gotSkin = true;
+                    gotFQ   = true;
+                } else if (category == Category::SkinTone) {
+                    if (gotSkin)
+                        break;
+                    gotSkin = true;
+                } else
+                    break;
+            } else if (!gotEmoji
+                       && (category == Category::Emoji || category == Category::SkinTone
+                           || category == Category::SimpleKeycap)) {
+                if (emojiStart == -1)
+                    emojiStart = idx;
+                if (category == Category::SimpleKeycap)
+                    idx += 2;
+                else {
+                    gotEmoji = true;
+                    if (category == Category::SkinTone) {
+                        idx++;
+                        break;
+                    }
+                }
+            } else if (emojiStart != -1) {
+                break;
+            }
+            if (in[idx].isHighSurrogate())
+                idx++;
+        }
+        return emojiStart == -1 ? QStringRef() : QStringRef(&in, emojiStart, idx - emojiStart);
+    }
+
+private:
+    std::map<quint32, quint32> ranges_; // first => last code point
+};
+
+class TestEmojiRegistry : public QObject {
+    Q_OBJECT
+
+private:
+    ReferenceRegistry reference;
+
+    // compares all the emoji found in text one after another
+    void compareSegments(const QString &text)
+    {
+        const EmojiRegistry &registry = EmojiRegistry::instance();
+
+        int idx = 0;
+        while (true) {
+            QStringRef expected = reference.findEmoji(text, idx);
+            QStringRef actual   = registry.findEmoji(text, idx);
+            QCOMPARE(actual.position(), expected.position());
+            QCOMPARE(actual.size(), expected.size());
+            if (expected.isEmpty())
+                break;
+            idx = expected.position() + expected.size();
+        }
+    }
+
+private slots:
+    void testCategory()
+    {
+        const EmojiRegistry &registry = EmojiRegistry::instance();
+        const QString        fq(QChar(0xfe0f));
+
+        for (uint ucs = 0; ucs <= QChar::LastValidCodePoint; ++ucs) {
+            if (QChar::isSurrogate(ucs))
+                continue;
+            // low code points are emoji only when fully qualified
+            for (const QString &s : { QString::fromUcs4(&ucs, 1), QString::fromUcs4(&ucs, 1) + fq }) {
+                if (registry.startCategory(&s) != reference.startCategory(&s))
+                    QFAIL(qPrintable(QString("category mismatch at U+%1").arg(ucs, 4, 16, QChar('0'))));
+            }
+        }
+    }
+
+    void testSegmentation()
+    {
+        QString previous;
+        for (const EmojiRegistry::Emoji &e : EmojiRegistry::instance()) {
+            compareSegments(e.code);
+            compareSegments("a " + e.code + " b");
+            compareSegments("a" + e.code + "b");
+            compareSegments(e.code + e.code);
+            compareSegments(previous + e.code);
+            compareSegments(previous + QChar(0x200d) + e.code);
+            if (QTest::currentTestFailed())
+                QFAIL(qPrintable("segmentation differs around " + e.name));
+            previous = e.code;
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestEmojiRegistry)
+#include "testemojiregistry.moc"
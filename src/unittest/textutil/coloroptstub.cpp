@@ -0,0 +1,27 @@
+// ColorOpt without the options behind it, so TextUtil can be tested alone
+
+#include "coloropt.h"
+
+ColorOpt::ColorOpt() { }
+
+ColorOpt *ColorOpt::instance()
+{
+    static ColorOpt colorOpt;
+    return &colorOpt;
+}
+
+QColor ColorOpt::color(const QString &opt, const QColor &defaultColor) const
+{
+    Q_UNUSED(opt)
+    return defaultColor;
+}
+
+QPalette::ColorRole ColorOpt::colorRole(const QString &opt) const
+{
+    Q_UNUSED(opt)
+    return QPalette::NoRole;
+}
+
+void ColorOpt::reset() { }
+
+void ColorOpt::optionChanged(const QString &opt) { Q_UNUSED(opt) }
@@ -0,0 +1,146 @@
+#include "iconset.h"
+#include "textutil.h"
+
+#include <QtTest/QtTest>
+
+// emoji runs are wrapped the same way emojiconifyPlainText() does it
+static QString emoji(const QString &text)
+{
+#if defined(WEBKIT) || defined(WEBENGINE)
+    return QLatin1String(R"html(<span class="emojis">)html") + text + QLatin1String("</span>");
+#else
+    return QLatin1String(
+               R"html(<span style="font-family: 'Apple Color Emoji', 'Noto Color Emoji', 'Segoe UI Emoji'; font-size:1.5em">)html")
+        + text + QLatin1String("</span>");
+#endif
+}
+
+static QString icon(const QString &name, const QString &text)
+{
+    return QString("<icon name=\"%1\" text=\"%2\" size=\"-1.4\" type=\"smiley\">").arg(name, text);
+}
+
+// The expected strings were produced by the old emoticonify() and
+// legacyFormat() chain, so formatMessage() is checked against them
+class TestTextUtil : public QObject {
+    Q_OBJECT
+
+private:
+    Iconset emoticons;
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(emoticons.load(QFINDTESTDATA("emoticons")));
+        TextUtil::setEmoticons({ &emoticons });
+    }
+
+    void cleanupTestCase() { TextUtil::setEmoticons({}); }
+
+    void testEmoticonify_data()
+    {
+        QTest::addColumn<QString>("input");
+        QTest::addColumn<QString>("expected");
+
+        QTest::newRow("plain") << "just some text"
+                               << "just some text";
+        QTest::newRow("entities") << "a &lt; b &amp; \"c\""
+                                  << "a &lt; b &amp; &quot;c&quot;";
+        QTest::newRow("tags") << "<b>x</b> y"
+                              << "<b>x</b> y";
+        QTest::newRow("emoticon") << "hi :)"
+                                  << "hi " + icon("smile", ":)");
+        QTest::newRow("longest text") << ":-) x" << icon("smile", ":-)") + " x";
+        QTest::newRow("no space around") << "a:)b"
+                                         << "a:)b";
+        QTest::newRow("space on one side") << "a:) b"
+                                           << "a" + icon("smile", ":)") + " b";
+        QTest::newRow("two emoticons") << ":) :(" << icon("smile", ":)") + " " + icon("sad", ":(");
+        QTest::newRow("escaped text") << "I &lt;3 you"
+                                      << "I " + icon("heart", "&lt;3") + " you";
+        QTest::newRow("in link") << "<a href=\"x\">:)</a>"
+                                 << "<a href=\"x\">" + icon("smile", ":)") + "</a>";
+        QTest::newRow("emoji text") << "hi 😊"
+                                    << "hi " + icon("smile", "😊");
+        QTest::newRow("emoji") << "hi 😀"
+                               << "hi " + emoji("😀");
+        QTest::newRow("emoji runs") << "😀😀 x 👍" << emoji("😀😀") + " x " + emoji("👍");
+        QTest::newRow("emoji and emoticon") << "😀 :)" << emoji("😀") + " " + icon("smile", ":)");
+    }
+
+    void testEmoticonify()
+    {
+        QFETCH(QString, input);
+        QFETCH(QString, expected);
+
+        QCOMPARE(TextUtil::emoticonify(input), expected);
+        QCOMPARE(TextUtil::formatMessage(input, true, false), expected);
+    }
+
+    void testFormatMessage_data()
+    {
+        QTest::addColumn<QString>("input");
+        QTest::addColumn<QString>("expected");
+
+        QTest::newRow("plain") << "just some text"
+                               << "just some text";
+        QTest::newRow("bold") << "*bold*"
+                              << "<b>*bold*</b>";
+        QTest::newRow("underline") << "_underline_"
+                                   << "<u>_underline_</u>";
+        QTest::newRow("italic") << "/italic/"
+                                << "<i>/italic/</i>";
+        QTest::newRow("in sentence") << "a *b* c _d_ e /f/ g"
+                                     << "a <b>*b*</b> c <u>_d_</u> e <i>/f/</i> g";
+        QTest::newRow("too short") << "** __ // * _ /"
+                                   << "** __ // * _ /";
+        QTest::newRow("unterminated") << "*bold _under /it"
+                                      << "*bold _under /it";
+        QTest::newRow("inner marker") << "*a*b* _a_b_"
+                                      << "<b>*a*b*</b> <u>_a_b_</u>";
+        QTest::newRow("same marker") << "**x** __y__"
+                                     << "<b>**x**</b> <u>__y__</u>";
+        QTest::newRow("punctuation") << "*bold*, _under_."
+                                     << "*bold*, _under_.";
+        QTest::newRow("path") << "see /usr/share/psi/ now"
+                              << "see <i>/usr/share/psi/</i> now";
+        QTest::newRow("multiline") << "*a*\n_b_\n/c/"
+                                   << "<b>*a*</b>\n<u>_b_</u>\n<i>/c/</i>";
+        QTest::newRow("in link") << "<a href=\"x\">*y*</a> _z_"
+                                 << "<a href=\"x\"><b>*y*</b></a> <u>_z_</u>";
+        QTest::newRow("after tag") << "<b>x</b> *y*"
+                                   << "<b>x</b> <b>*y*</b>";
+        QTest::newRow("with emoticon") << "*hi* :)"
+                                       << "<b>*hi*</b> " + icon("smile", ":)");
+
+        // these differ from the old chain on purpose: both formats are applied
+        QTest::newRow("nested bold underline") << "*_x_*"
+                                               << "<b>*<u>_x_</u>*</b>";
+        QTest::newRow("nested underline italic") << "_/x/_"
+                                                 << "<u>_<i>/x/</i>_</u>";
+    }
+
+    void testFormatMessage()
+    {
+        QFETCH(QString, input);
+        QFETCH(QString, expected);
+
+        QCOMPARE(TextUtil::formatMessage(input, true, true), expected);
+    }
+
+    void testFormatMessage_NoEmoticons()
+    {
+        QCOMPARE(TextUtil::formatMessage("*a* :) 😀", false, true), QString("<b>*a*</b> :) 😀"));
+        QCOMPARE(TextUtil::formatMessage("*a* :) 😀", false, false), QString("*a* :) 😀"));
+    }
+
+    // QBENCHMARK reports the time per message, i.e. 1/messages per second
+    void benchmarkFormatMessage()
+    {
+        const QString message = "Hi there :) see /usr/share/psi/ for *this* one 😀 and <a href=\"x\">that</a> &lt;3";
+        QBENCHMARK { TextUtil::formatMessage(message, true, true); }
+    }
+};
+
+QTEST_MAIN(TestTextUtil)
+#include "testtextutil.moc"
@@ -0,0 +1,4 @@
+TARGET = testtextutil
+SOURCES += testtextutil.cpp
+
+include(../half_of_psi.pri)
@@ -20,27 +20,27 @@
 #include "vcardfactory.h"
 
 #include "applicationinfo.h"
-#include "jidutil.h"
 #include "profiles.h"
 #include "psiaccount.h"
+#include "vcardstore.h"
 #include "xmpp_client.h"
 #include "xmpp_tasks.h"
 #include "xmpp_vcard.h"
 
 #include <QApplication>
-#include <QDir>
 #include <QDomDocument>
-#include <QFile>
-#include <QMap>
 #include <QObject>
-#include <QTextStream>
 
 #include <functional>
 
 /**
  * \brief Factory for retrieving and changing VCards.
  */
-VCardFactory::VCardFactory() : QObject(qApp), dictSize_(5) { }
+VCardFactory::VCardFactory() : QObject(qApp), dictSize_(100), mucDictSize_(2048)
+{
+    vcardDict_.setMaxCost(dictSize_);
+    mucVcardDict_.setMaxCost(mucDictSize_);
+}
 
 /**
  * \brief Destroys all cached VCards.
@@ -59,20 +59,54 @@ VCardFactory *VCardFactory::instance()
 }
 
 /**
- * Adds a vcard to the cache (and removes other items if necessary)
+ * Opens vCards store of the active profile. Called on profile load, so the
+ * index is usually ready by the time the first vCard is requested.
+ */
+void VCardFactory::openStore() { store(); }
+
+/**
+ * Opens vCards store on first use, when the profile is already known.
+ */
+VCardStore *VCardFactory::store()
+{
+    if (!store_) {
+        QString cacheDir = pathToProfile(activeProfile, ApplicationInfo::CacheLocation);
+        store_           = new VCardStore(cacheDir + "/vcards.db", cacheDir + "/vcard", this);
+        connect(store_, &VCardStore::loaded, this, &VCardFactory::storeLoaded);
+    }
+    return store_;
+}
+
+static VCard vcardFromXml(const QByteArray &xml)
+{
+    QDomDocument doc;
+    if (!xml.isEmpty() && doc.setContent(xml, false)) {
+        return VCard::fromXml(doc.documentElement());
+    }
+    return VCard();
+}
+
+/**
+ * Adds a vcard to the cache (and removes least recently used items if necessary)
  */
-void VCardFactory::checkLimit(const QString &jid, const VCard &vcard)
+void VCardFactory::checkLimit(const QString &jid, const VCard &vcard) { vcardDict_.insert(jid, new VCard(vcard)); }
+
+void VCardFactory::storeLoaded(const QString &bareJid, const QByteArray &xml)
 {
-    if (vcardList_.contains(jid)) {
-        vcardList_.removeAll(jid);
-        vcardDict_.remove(jid);
-    } else if (vcardList_.size() > dictSize_) {
-        QString j = vcardList_.takeLast();
-        vcardDict_.remove(j);
+    loading_.remove(bareJid);
+
+    VCard vcard = vcardFromXml(xml);
+    if (vcard.isNull() || vcardDict_.contains(bareJid)) {
+        return; // nothing stored or already updated from server
     }
 
-    vcardDict_.insert(jid, vcard);
-    vcardList_.push_front(jid);
+    checkLimit(bareJid, vcard);
+
+    Jid jid(bareJid);
+    emit vcardChanged(jid);
+    if (!vcard.photo().isEmpty()) {
+        emit vcardPhotoAvailable(jid, false);
+    }
 }
 
 void VCardFactory::taskFinished()
@@ -91,19 +125,11 @@ void VCardFactory::mucTaskFinished()
     JT_VCard *task        = static_cast<JT_VCard *>(sender());
     bool      notifyPhoto = task->property("phntf").toBool();
     if (task->success()) {
-        Jid   j          = task->jid();
-        auto &nick2vcard = mucVcardDict_[j.bare()];
-        auto  nickIt     = nick2vcard.find(j.resource());
-        if (nickIt == nick2vcard.end()) {
-            nick2vcard.insert(j.resource(), task->vcard());
-            auto &resQueue = lastMucVcards_[j.bare()];
-            resQueue.enqueue(j.resource());
-            while (resQueue.size() > 3) { // keep max 3 vcards per muc
-                nick2vcard.remove(resQueue.dequeue());
-            }
-        } else {
-            *nickIt = task->vcard();
-        }
+        Jid j = task->jid();
+        // occupants vCards aren't stored on disk, so just keep the recent ones up to some size.
+        // a huge one still has to be kept, or QCache would drop it right away
+        int cost = 1 + task->vcard().photo().size() / 1024;
+        mucVcardDict_.insert(j.full(), new VCard(task->vcard()), qMin(cost, mucDictSize_));
 
         emit vcardChanged(j);
         if (notifyPhoto && !task->vcard().photo().isEmpty()) {
@@ -115,22 +141,12 @@ void VCardFactory::mucTaskFinished()
 void VCardFactory::saveVCard(const Jid &j, const VCard &vcard, bool notifyPhoto)
 {
     checkLimit(j.bare(), vcard);
+    loading_.remove(j.bare());
 
-    // save vCard to disk
-
-    // ensure that there's a vcard directory to save into
-    QDir p(pathToProfile(activeProfile, ApplicationInfo::CacheLocation));
-    QDir v(pathToProfile(activeProfile, ApplicationInfo::CacheLocation) + "/vcard");
-    if (!v.exists())
-        p.mkdir("vcard");
-
-    QFile file(ApplicationInfo::vCardDir() + '/' + JIDUtil::encode(j.bare()).toLower() + ".xml");
-    file.open(QIODevice::WriteOnly);
-    QTextStream out(&file);
-    out.setCodec("UTF-8");
+    // save vCard to disk in background
     QDomDocument doc;
     doc.appendChild(vcard.toXml(&doc));
-    out << doc.toString(4);
+    store()->write(j.bare(), doc.toByteArray(-1));
 
     Jid  jid = j;
     emit vcardChanged(jid);
@@ -145,37 +161,55 @@ void VCardFactory::saveVCard(const Jid &j, const VCard &vcard, bool notifyPhoto)
  */
 const VCard VCardFactory::mucVcard(const Jid &j) const
 {
-    QHash<QString, VCard>                d  = mucVcardDict_.value(j.bare());
-    QHash<QString, VCard>::ConstIterator it = d.constFind(j.resource());
-    if (it != d.constEnd()) {
-        return *it;
-    }
-    return VCard();
+    const VCard *vcard = mucVcardDict_.object(j.full());
+    return vcard ? *vcard : VCard();
 }
 
 /**
  * \brief Call this, when you need a cached vCard.
+ *
+ * If the vCard isn't in the runtime cache, it's read from disk synchronously.
+ * While the store is still opening, this waits for the index to be loaded.
+ * Prefer cachedVCard() in frequently called code.
  */
 VCard VCardFactory::vcard(const Jid &j)
 {
     // first, try to get vCard from runtime cache
-    if (vcardDict_.contains(j.bare())) {
-        return vcardDict_[j.bare()];
+    const QString bare   = j.bare();
+    const VCard * cached = vcardDict_.object(bare);
+    if (cached) {
+        return *cached;
     }
 
     // then try to load from cache on disk
-    QFile file(ApplicationInfo::vCardDir() + '/' + JIDUtil::encode(j.bare()).toLower() + ".xml");
-    file.open(QIODevice::ReadOnly);
-    QDomDocument doc;
+    if (!store()->contains(bare)) {
+        return VCard();
+    }
+    VCard vcard = vcardFromXml(store()->read(bare));
+    if (!vcard.isNull()) {
+        checkLimit(bare, vcard);
+    }
+    return vcard;
+}
 
-    if (doc.setContent(&file, false)) {
-        VCard vcard = VCard::fromXml(doc.documentElement());
-        if (!vcard.isNull()) {
-            checkLimit(j.bare(), vcard);
-            return vcard;
-        }
+/**
+ * \brief Returns vCard from the runtime cache without touching the disk.
+ *
+ * If the vCard is only on disk, it's loaded in background and vcardChanged()
+ * (as well as vcardPhotoAvailable()) is emitted when it's ready.
+ */
+VCard VCardFactory::cachedVCard(const Jid &j)
+{
+    const QString bare   = j.bare();
+    const VCard * cached = vcardDict_.object(bare);
+    if (cached) {
+        return *cached;
     }
 
+    if (!loading_.contains(bare) && store()->contains(bare)) {
+        loading_.insert(bare);
+        store()->readAsync(bare);
+    }
     return VCard();
 }
 
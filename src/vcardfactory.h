@@ -20,13 +20,14 @@
 #ifndef VCARDFACTORY_H
 #define VCARDFACTORY_H
 
-#include <QHash>
-#include <QMap>
+#include <QCache>
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 #include <functional>
 
 class PsiAccount;
+class VCardStore;
 
 namespace XMPP {
 class JT_VCard;
@@ -41,7 +42,9 @@ class VCardFactory : public QObject {
 
 public:
     static VCardFactory *instance();
+    void                 openStore();
     VCard                vcard(const Jid &);
+    VCard                cachedVCard(const Jid &);
     const VCard          mucVcard(const Jid &j) const;
     void                 setVCard(const Jid &, const VCard &, bool notifyPhoto = true);
     void setVCard(const PsiAccount *account, const VCard &v, QObject *obj = nullptr, const char *slot = nullptr);
@@ -62,20 +65,22 @@ private slots:
     void updateVCardFinished();
     void taskFinished();
     void mucTaskFinished();
+    void storeLoaded(const QString &bareJid, const QByteArray &xml);
 
 private:
     VCardFactory();
     ~VCardFactory();
 
-    static VCardFactory *                instance_;
-    const int                            dictSize_;
-    QStringList                          vcardList_;
-    QMap<QString, VCard>                 vcardDict_;
-    QMap<QString, QHash<QString, VCard>> mucVcardDict_; // QHash in case of big mucs mucBareJid => {resoure => vcard}
-    QMap<QString, QQueue<QString>>
-        lastMucVcards_; // to limit the hash above. this one keeps ordered resource. mucBareJid => resource_list
+    static VCardFactory *  instance_;
+    const int              dictSize_;
+    const int              mucDictSize_;
+    QCache<QString, VCard> vcardDict_;    // bareJid => vcard. least recently used are dropped first
+    QCache<QString, VCard> mucVcardDict_; // fullJid => vcard. bounded by size of vcards in KiB
+    QSet<QString>          loading_;      // bare jids being loaded from the store in background
+    VCardStore *           store_ = nullptr;
 
-    void saveVCard(const Jid &, const VCard &, bool notifyPhoto);
+    VCardStore *store();
+    void        saveVCard(const Jid &, const VCard &, bool notifyPhoto);
 };
 
 #endif // VCARDFACTORY_H
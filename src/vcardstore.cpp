@@ -0,0 +1,261 @@
+/*
+ * vcardstore.cpp - indexed on-disk storage for cached vCards
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "vcardstore.h"
+
+#include "jidutil.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimer>
+
+#define VCARD_DB_CONNECTION "vcards"
+#define VCARD_FLUSH_INTERVAL 500 // ms
+
+//----------------------------------------------------------------------------
+// VCardStore::Worker
+//----------------------------------------------------------------------------
+
+// Lives in the store thread and is the only user of the database connection
+class VCardStore::Worker : public QObject {
+    Q_OBJECT
+
+public:
+    Worker()
+    {
+        flushTimer_ = new QTimer(this);
+        flushTimer_->setSingleShot(true);
+        flushTimer_->setInterval(VCARD_FLUSH_INTERVAL);
+        connect(flushTimer_, &QTimer::timeout, this, &Worker::flush);
+    }
+
+signals:
+    void indexLoaded(const QStringList &jids);
+    void loaded(const QString &bareJid, const QByteArray &xml);
+
+public slots:
+    void open(const QString &dbPath, const QString &legacyDir)
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", VCARD_DB_CONNECTION);
+        db.setDatabaseName(dbPath);
+        if (!db.open()) {
+            qWarning("VCardStore: can't open %s: %s", qUtf8Printable(dbPath), qUtf8Printable(db.lastError().text()));
+            emit indexLoaded(QStringList());
+            return;
+        }
+
+        QSqlQuery query(db);
+        if (!db.tables(QSql::Tables).contains("vcards")) {
+            query.exec("CREATE TABLE `vcards` ("
+                       "`jid` TEXT PRIMARY KEY, "
+                       "`data` BLOB"
+                       ");");
+            migrate(legacyDir);
+        }
+
+        QStringList jids;
+        query.exec("SELECT `jid` FROM `vcards`;");
+        while (query.next()) {
+            jids.append(query.value(0).toString());
+        }
+        emit indexLoaded(jids);
+    }
+
+    void close()
+    {
+        flush();
+        {
+            QSqlDatabase db = QSqlDatabase::database(VCARD_DB_CONNECTION, false);
+            if (db.isOpen()) {
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(VCARD_DB_CONNECTION);
+    }
+
+    QByteArray read(const QString &bareJid)
+    {
+        auto it = pending_.constFind(bareJid);
+        if (it != pending_.constEnd()) {
+            return it.value();
+        }
+
+        QSqlQuery query(QSqlDatabase::database(VCARD_DB_CONNECTION));
+        query.prepare("SELECT `data` FROM `vcards` WHERE `jid` = ?;");
+        query.addBindValue(bareJid);
+        if (query.exec() && query.next()) {
+            return qUncompress(query.value(0).toByteArray());
+        }
+        return QByteArray();
+    }
+
+    void readAsync(const QString &bareJid) { emit loaded(bareJid, read(bareJid)); }
+
+    void write(const QString &bareJid, const QByteArray &xml)
+    {
+        // a burst of vCards (e.g. on login) is written in one transaction
+        pending_.insert(bareJid, xml);
+        if (!flushTimer_->isActive()) {
+            flushTimer_->start();
+        }
+    }
+
+    void flush()
+    {
+        if (pending_.isEmpty()) {
+            return;
+        }
+
+        QSqlDatabase db = QSqlDatabase::database(VCARD_DB_CONNECTION);
+        if (!db.isOpen()) {
+            pending_.clear();
+            return;
+        }
+
+        db.transaction();
+        QSqlQuery query(db);
+        query.prepare("INSERT OR REPLACE INTO `vcards` (`jid`, `data`) VALUES (?, ?);");
+        for (auto it = pending_.constBegin(); it != pending_.constEnd(); ++it) {
+            query.addBindValue(it.key());
+            query.addBindValue(qCompress(it.value()));
+            if (!query.exec()) {
+                qWarning("VCardStore: failed to save vCard for %s: %s", qUtf8Printable(it.key()),
+                         qUtf8Printable(query.lastError().text()));
+            }
+        }
+        db.commit();
+        pending_.clear();
+    }
+
+private:
+    // one-time import of the old per-file vCard cache
+    void migrate(const QString &legacyDir)
+    {
+        QDir dir(legacyDir);
+        if (legacyDir.isEmpty() || !dir.exists()) {
+            return;
+        }
+
+        const auto files = dir.entryInfoList(QStringList() << "*.xml", QDir::Files);
+        for (const QFileInfo &fi : files) {
+            QFile file(fi.filePath());
+            if (file.open(QIODevice::ReadOnly)) {
+                pending_.insert(JIDUtil::decode(fi.completeBaseName()), file.readAll());
+            }
+        }
+        flush();
+
+        // the files are left in place, since plugins still read them via appVCardDir()
+        qDebug("VCardStore: %d vCards migrated from %s", files.count(), qUtf8Printable(legacyDir));
+    }
+
+    QTimer *                   flushTimer_;
+    QHash<QString, QByteArray> pending_; // bareJid => xml
+};
+
+//----------------------------------------------------------------------------
+// VCardStore
+//----------------------------------------------------------------------------
+
+/**
+ * \class VCardStore
+ * \brief Keeps cached vCards in a single SQLite file
+ *
+ * All disk access is done in a dedicated thread. Writes are batched and
+ * committed in one transaction. An in-memory index of stored JIDs allows to
+ * skip the disk entirely for contacts without a cached vCard.
+ */
+VCardStore::VCardStore(const QString &dbPath, const QString &legacyDir, QObject *parent) :
+    QObject(parent), thread_(new QThread(this)), worker_(new Worker)
+{
+    worker_->moveToThread(thread_);
+    connect(thread_, &QThread::finished, worker_, &QObject::deleteLater);
+    connect(worker_, &Worker::indexLoaded, this, &VCardStore::indexLoaded);
+    connect(worker_, &Worker::loaded, this, &VCardStore::loaded);
+    thread_->start(QThread::LowPriority);
+
+    QMetaObject::invokeMethod(worker_, "open", Qt::QueuedConnection, Q_ARG(QString, dbPath),
+                              Q_ARG(QString, legacyDir));
+}
+
+VCardStore::~VCardStore()
+{
+    QMetaObject::invokeMethod(worker_, "close", Qt::BlockingQueuedConnection);
+    thread_->quit();
+    thread_->wait();
+}
+
+/**
+ * Returns \c false if there is surely no vCard for \a bareJid in the store.
+ */
+bool VCardStore::contains(const QString &bareJid) const
+{
+    QMutexLocker locker(&mutex_);
+    return !indexReady_ || index_.contains(bareJid);
+}
+
+/**
+ * Reads vCard XML of \a bareJid. Blocks until the store thread returns it.
+ * The store thread opens the database first, so a read issued before the
+ * index is loaded waits for that (and for the migration of the old cache).
+ */
+QByteArray VCardStore::read(const QString &bareJid)
+{
+    QByteArray ret;
+    QMetaObject::invokeMethod(worker_, "read", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QByteArray, ret),
+                              Q_ARG(QString, bareJid));
+    return ret;
+}
+
+/**
+ * Reads vCard XML of \a bareJid in background. loaded() is emitted when done.
+ */
+void VCardStore::readAsync(const QString &bareJid)
+{
+    QMetaObject::invokeMethod(worker_, "readAsync", Qt::QueuedConnection, Q_ARG(QString, bareJid));
+}
+
+/**
+ * Stores vCard XML of \a bareJid in background.
+ */
+void VCardStore::write(const QString &bareJid, const QByteArray &xml)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        index_.insert(bareJid);
+    }
+    QMetaObject::invokeMethod(worker_, "write", Qt::QueuedConnection, Q_ARG(QString, bareJid), Q_ARG(QByteArray, xml));
+}
+
+void VCardStore::indexLoaded(const QStringList &jids)
+{
+    QMutexLocker locker(&mutex_);
+    for (const QString &j : jids) {
+        index_.insert(j);
+    }
+    indexReady_ = true;
+}
+
+#include "vcardstore.moc"
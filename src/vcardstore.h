@@ -0,0 +1,60 @@
+/*
+ * vcardstore.h - indexed on-disk storage for cached vCards
+ * Copyright (C) 2026  Psi Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef VCARDSTORE_H
+#define VCARDSTORE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QThread;
+
+class VCardStore : public QObject {
+    Q_OBJECT
+
+public:
+    VCardStore(const QString &dbPath, const QString &legacyDir, QObject *parent = nullptr);
+    ~VCardStore();
+
+    bool       contains(const QString &bareJid) const;
+    QByteArray read(const QString &bareJid);
+    void       readAsync(const QString &bareJid);
+    void       write(const QString &bareJid, const QByteArray &xml);
+
+signals:
+    void loaded(const QString &bareJid, const QByteArray &xml);
+
+private slots:
+    void indexLoaded(const QStringList &jids);
+
+private:
+    class Worker;
+
+    QThread *      thread_;
+    Worker *       worker_;
+    mutable QMutex mutex_;
+    QSet<QString>  index_;
+    bool           indexReady_ = false;
+};
+
+#endif // VCARDSTORE_H
@@ -81,11 +81,14 @@ WbItem::WbItem(SxeSession *session, QSvgRenderer *renderer, QDomElement node, Wb
     // Enable drag-n-drop
     setAcceptDrops(true);
 
-    // Don't cache the SVG
-    setCachingEnabled(false);
+    // Cache the rendered SVG so that unchanged items aren't rerendered on each scene update
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
 
     // Set the renderer for the item
     setSharedRenderer(renderer);
+    // The renderer is reloaded after every edit of the document. WbWidget::rerender()
+    // repaints the items whose elements changed so don't repaint on every reload.
+    QObject::disconnect(renderer, &QSvgRenderer::repaintNeeded, this, nullptr);
 
     // add the new item to the scene
     addToScene();
@@ -291,20 +294,21 @@ void WbItem::removeFromScene()
     setElementId(QString());
 }
 
-void WbItem::resetPos()
+void WbItem::resetPos(int zValue)
 {
     // set the x & y approriately;
     setPos(renderer()->boundsOnElement(id()).topLeft());
 
     // set the drawing order
-    // TODO: optimize
-    int          i        = 0;
-    QDomNodeList children = node_.parentNode().childNodes();
-    while (children.at(i) != node_) {
-        i++;
+    if (zValue < 0) {
+        zValue                = 0;
+        QDomNodeList children = node_.parentNode().childNodes();
+        while (children.at(zValue) != node_) {
+            zValue++;
+        }
     }
 
-    setZValue(i);
+    setZValue(zValue);
 }
 
 WbItemMenu *WbItem::constructContextMenu()
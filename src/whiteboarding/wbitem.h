@@ -84,8 +84,10 @@ public:
     /*! \brief Removes the item from the scene. */
     void removeFromScene();
 
-    /*! \brief Resets the position of the item according to the SVG and clears any QGraphicsItem transformations.*/
-    void resetPos();
+    /*! \brief Resets the position of the item according to the SVG and clears any QGraphicsItem transformations.
+     *  \a zValue is the index of the node among its siblings. It's looked up if negative.
+     */
+    void resetPos(int zValue = -1);
 
     /*! \brief Returns a QTransform based on \a string provided in the SVG 'transform' attribute format.*/
     static QMatrix parseSvgTransform(QString string);
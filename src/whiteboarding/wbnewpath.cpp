@@ -24,6 +24,56 @@
 
 #include <QGraphicsScene>
 #include <QPainterPath>
+#include <QStack>
+#include <cmath>
+
+// Maximum distance (in pixels) a simplified stroke may deviate from the drawn one
+#define SIMPLIFY_TOLERANCE 0.75
+
+// Ramer-Douglas-Peucker simplification of a polyline
+static QVector<QPointF> simplifyPolyline(const QVector<QPointF> &points, qreal tolerance)
+{
+    if (points.size() < 3)
+        return points;
+
+    QVector<bool> keep(points.size(), false);
+    keep.first() = true;
+    keep.last()  = true;
+
+    QStack<QPair<int, int>> ranges;
+    ranges.push(qMakePair(0, points.size() - 1));
+    while (!ranges.isEmpty()) {
+        const auto    range = ranges.pop();
+        const QPointF a     = points[range.first];
+        const QPointF d     = points[range.second] - a;
+        const qreal   len   = std::hypot(d.x(), d.y());
+
+        // find the point farthest from the segment
+        qreal maxDist = 0;
+        int   index   = -1;
+        for (int i = range.first + 1; i < range.second; i++) {
+            const QPointF p    = points[i] - a;
+            const qreal   dist = len > 0 ? qAbs(d.x() * p.y() - d.y() * p.x()) / len : std::hypot(p.x(), p.y());
+            if (dist > maxDist) {
+                maxDist = dist;
+                index   = i;
+            }
+        }
+
+        if (index >= 0 && maxDist > tolerance) {
+            keep[index] = true;
+            ranges.push(qMakePair(range.first, index));
+            ranges.push(qMakePair(index, range.second));
+        }
+    }
+
+    QVector<QPointF> ret;
+    for (int i = 0; i < points.size(); i++) {
+        if (keep[i])
+            ret.append(points[i]);
+    }
+    return ret;
+}
 
 WbNewPath::WbNewPath(QGraphicsScene *s, QPointF startPos, int strokeWidth, const QColor &strokeColor,
                      const QColor &fillColor) :
@@ -41,6 +91,8 @@ WbNewPath::WbNewPath(QGraphicsScene *s, QPointF startPos, int strokeWidth, const
     QPainterPath painterpath(startPos);
     painterpath.setFillRule(Qt::WindingFill);
     graphicsitem_.setPath(painterpath);
+
+    points_.append(startPos);
 }
 
 WbNewPath::~WbNewPath()
@@ -52,6 +104,8 @@ WbNewPath::~WbNewPath()
 
 void WbNewPath::parseCursorMove(QPointF newPos)
 {
+    points_.append(newPos);
+
     if (controlPoint_) {
         QPainterPath painterpath = graphicsitem_.path();
         // FIXME: the path should actually go through the "controlPoint_".
@@ -67,14 +121,20 @@ void WbNewPath::parseCursorMove(QPointF newPos)
 
 QDomNode WbNewPath::serializeToSvg(QDomDocument *doc)
 {
-    if (controlPoint_) {
-        QPainterPath painterpath = graphicsitem_.path();
-        painterpath.lineTo(*controlPoint_);
-        graphicsitem_.setPath(painterpath);
+    delete controlPoint_;
+    controlPoint_ = nullptr;
 
-        delete controlPoint_;
-        controlPoint_ = nullptr;
+    // Drop the points that don't noticeably change the shape of the stroke and
+    // smooth the rest with quadratic curves through the midpoints of the segments
+    const QVector<QPointF> points = simplifyPolyline(points_, SIMPLIFY_TOLERANCE);
+    QPainterPath           painterpath(points.first());
+    painterpath.setFillRule(Qt::WindingFill);
+    for (int i = 1; i < points.size() - 1; i++) {
+        painterpath.quadTo(points[i], (points[i] + points[i + 1]) / 2);
     }
+    if (points.size() > 1)
+        painterpath.lineTo(points.last());
+    graphicsitem_.setPath(painterpath);
 
     // trim the generated SVG to remove unnecessary nested <g/>'s
 
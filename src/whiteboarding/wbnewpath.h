@@ -23,6 +23,8 @@
 
 #include "wbnewitem.h"
 
+#include <QVector>
+
 class WbNewPath : public WbNewItem {
 public:
     WbNewPath(QGraphicsScene *s, QPointF startPos, int strokeWidth, const QColor &strokeColor, const QColor &fillColor);
@@ -36,6 +38,7 @@ protected:
 private:
     QGraphicsPathItem graphicsitem_;
     QPointF *         controlPoint_;
+    QVector<QPointF>  points_;
 };
 
 #endif // WBNEWPATH_H
@@ -38,6 +38,7 @@ WbWidget::WbWidget(SxeSession *session, QWidget *parent) : QGraphicsView(parent)
     fillColor_   = Qt::transparent;
     strokeWidth_ = 1;
     session_     = session;
+    dirtyAll_    = true;
 
     //    setCacheMode(CacheBackground);
     setRenderHint(QPainter::Antialiasing);
@@ -51,7 +52,8 @@ WbWidget::WbWidget(SxeSession *session, QWidget *parent) : QGraphicsView(parent)
 
     // create the scene
     scene_ = new WbScene(session_, this);
-    scene_->setItemIndexMethod(QGraphicsScene::NoIndex);
+    // items are mostly static so index them for faster hit testing and repaints
+    scene_->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
     setRenderHint(QPainter::Antialiasing);
     setTransformationAnchor(AnchorUnderMouse);
     setResizeAnchor(AnchorViewCenter);
@@ -83,6 +85,11 @@ WbWidget::WbWidget(SxeSession *session, QWidget *parent) : QGraphicsView(parent)
     connect(session_, SIGNAL(nodeAdded(QDomNode, bool)), SLOT(checkForViewBoxChange(QDomNode)));
     connect(session_, SIGNAL(nodeMoved(QDomNode, bool)), SLOT(checkForViewBoxChange(QDomNode)));
     connect(session_, SIGNAL(chdataChanged(QDomNode, bool)), SLOT(checkForViewBoxChange(QDomNode)));
+    // repaint only the items that changed
+    connect(session_, SIGNAL(nodeAdded(QDomNode, bool)), SLOT(markDirty(QDomNode)));
+    connect(session_, SIGNAL(nodeMoved(QDomNode, bool)), SLOT(markDirty(QDomNode)));
+    connect(session_, SIGNAL(nodeToBeRemoved(QDomNode, bool)), SLOT(markDirty(QDomNode)));
+    connect(session_, SIGNAL(chdataChanged(QDomNode, bool)), SLOT(markDirty(QDomNode)));
 
     // set the default mode to select
     setMode(Mode::Select);
@@ -445,13 +452,44 @@ void WbWidget::rerender()
 
     renderer_.load(xmldump.toLatin1());
 
+    // find the drawing order of all items at once
+    QHash<QString, int> zValues;
+    const QDomNodeList  children = session_->document().documentElement().childNodes();
+    for (int i = 0; i < children.size(); i++) {
+        const QDomElement element = children.at(i).toElement();
+        if (element.hasAttribute("id"))
+            zValues[element.attribute("id")] = i;
+    }
+
     // Update all positions if changed
     for (WbItem *wbitem : qAsConst(items_)) {
+        const QString id = wbitem->id();
+
         // resetting elementId is necessary for rendering some updates to the element (e.g. adding child elements to
-        // <g/>)
-        wbitem->setElementId(wbitem->id());
+        // <g/>). It also repaints the item so it's only done if the element changed.
+        if (dirtyAll_ || dirtyIds_.contains(id))
+            wbitem->setElementId(id);
 
         // qDebug() << QString("Rerendering %1").arg((unsigned int) wbitem).toLatin1();
-        wbitem->resetPos();
+        wbitem->resetPos(zValues.value(id, -1));
     }
+
+    dirtyIds_.clear();
+    dirtyAll_ = false;
+}
+
+void WbWidget::markDirty(const QDomNode &node)
+{
+    const QDomElement root = session_->document().documentElement();
+
+    // find the child of the root <svg/> containing the node
+    QDomNode n = node.isAttr() ? QDomNode(node.toAttr().ownerElement()) : node;
+    while (!n.isNull() && n.parentNode() != root)
+        n = n.parentNode();
+
+    // changes to the root itself (e.g. 'viewBox') affect all items
+    if (n.isNull())
+        dirtyAll_ = true;
+    else if (n.isElement())
+        dirtyIds_ += n.toElement().attribute("id");
 }
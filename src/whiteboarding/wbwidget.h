@@ -28,6 +28,7 @@
 
 #include <QFileDialog>
 #include <QGraphicsView>
+#include <QSet>
 #include <QSvgRenderer>
 #include <QTime>
 #include <QTimer>
@@ -135,6 +136,10 @@ private:
     QTimer *adding_;
     /*! \brief The primary renderer used for rendering the document.*/
     QSvgRenderer renderer_;
+    /*! \brief 'id's of the items whose elements changed since the last rerender().*/
+    QSet<QString> dirtyIds_;
+    /*! \brief True if all items need to be repainted at the next rerender().*/
+    bool dirtyAll_;
 
 private slots:
     /*! \brief Tries to add 'id' attributes to nodes in deletionQueue_ if they still don't have them.*/
@@ -162,6 +167,8 @@ private slots:
      *  If so, the scene size is adjusted accordingly.
      */
     void checkForViewBoxChange(const QDomNode &node);
+    /*! \brief Marks the item containing \a node to be repainted at the next rerender().*/
+    void markDirty(const QDomNode &node);
     // /*! \brief Deletes the WbItem's in the deletion queue. */
     // void flushDeletionQueue();
 
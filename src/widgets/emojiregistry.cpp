@@ -33,18 +33,32 @@ bool EmojiRegistry::isEmoji(const QString &code) const
     // TODO check the whole code is emoji. not just start
 }
 
+static inline bool isEmojiCodePoint(quint32 ucs)
+{
+    const quint32 block = ucs >> 8;
+    if (block >= sizeof(emojiBlockIndex))
+        return false;
+    const quint8 idx = emojiBlockIndex[block];
+    return idx && (emojiBlocks[idx - 1][(ucs & 0xff) >> 5] >> (ucs & 0x1f)) & 1;
+}
+
 EmojiRegistry::Category EmojiRegistry::startCategory(QStringRef in) const
 {
-    if (in.isEmpty())
+    return category(in.constData(), in.length());
+}
+
+EmojiRegistry::Category EmojiRegistry::category(const QChar *in, int length)
+{
+    if (!length)
         return Category::None;
     std::uint32_t ucs;
     if (in[0].isHighSurrogate()) {
-        if (in.length() == 1)
+        if (length == 1)
             return Category::None;
         ucs = QChar::surrogateToUcs4(in[0], in[1]);
     } else {
         ucs = in[0].unicode();
-        if (ucs < 256 && (in.length() == 1 || in[1].unicode() != 0xfe0f)) {
+        if (ucs < 256 && (length == 1 || in[1].unicode() != 0xfe0f)) {
             return Category::None; // allow only full-qualified emojis from low range
         }
     }
@@ -52,19 +66,12 @@ EmojiRegistry::Category EmojiRegistry::startCategory(QStringRef in) const
         return Category::ZWJ;
     if (ucs == 0xfe0f)
         return Category::FullQualify;
-    if (ucs <= 0x39 && in.length() > 2 && (ucs >= 0x30 || ucs == 0x2a || ucs == 0x23) && in[1].unicode() == 0xfe0f
+    if (ucs <= 0x39 && length > 2 && (ucs >= 0x30 || ucs == 0x2a || ucs == 0x23) && in[1].unicode() == 0xfe0f
         && in[2].unicode() == 0x20e3)
         // number, * or #. excludes 10 keycap
         return Category::SimpleKeycap;
 
-    bool found = false;
-    auto lb    = ranges_.lower_bound(ucs);
-    if (lb == ranges_.end() || lb->first != ucs) {
-        --lb;
-        found = (ucs > lb->first && ucs <= lb->second); // if this is a final range
-    } else
-        found = lb->first == ucs;
-    if (found) {
+    if (isEmojiCodePoint(ucs)) {
         if (ucs >= 0x1f3fb && ucs <= 0x1f3ff)
             return Category::SkinTone;
         return Category::Emoji; // there more cases to review. like emoji tags/flags etc
@@ -90,8 +97,10 @@ QStringRef EmojiRegistry::findEmoji(const QString &in, int idx) const
     bool gotEmoji = false;
     bool gotSkin  = false;
     bool gotFQ    = false;
+
+    const QChar *data = in.constData();
     for (; idx < in.size(); idx++) {
-        auto category = startCategory(QStringRef(&in, idx, in.size() - idx));
+        auto category = EmojiRegistry::category(data + idx, in.size() - idx);
         if (gotEmoji && category != Category::None) {
             if (category == Category::ZWJ) { // zero-width joiner
                 gotEmoji = false;
@@ -131,7 +140,7 @@ QStringRef EmojiRegistry::findEmoji(const QString &in, int idx) const
     return emojiStart == -1 ? QStringRef() : QStringRef(&in, emojiStart, idx - emojiStart);
 }
 
-EmojiRegistry::EmojiRegistry() : groups(std::move(db)), ranges_(std::move(ranges)) { }
+EmojiRegistry::EmojiRegistry() : groups(std::move(db)) { }
 
 EmojiRegistry::iterator &EmojiRegistry::iterator::operator++()
 {
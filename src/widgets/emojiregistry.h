@@ -22,7 +22,6 @@
 
 #include <QString>
 
-#include <map>
 #include <vector>
 
 class EmojiRegistry {
@@ -87,7 +86,7 @@ private:
     EmojiRegistry(const EmojiRegistry &) = delete;
     EmojiRegistry &operator=(const EmojiRegistry &) = delete;
 
-    const std::map<quint32, quint32> ranges_; // start to end range mapping
+    static Category category(const QChar *in, int length);
 };
 
 #endif // EMOJIREGISTRY_H
@@ -22,21 +22,33 @@
 
 #include <QAbstractTextDocumentLayout> // for QTextObjectInterface
 #include <QApplication>
+#include <QBuffer>
+#include <QCache>
 #include <QCryptographicHash>
 #include <QFileInfo>
 #include <QFont>
+#include <QHash>
+#include <QImageReader>
 #include <QList>
 #include <QPainter>
+#include <QPointer>
 #include <QQueue>
 #include <QRegExp>
 #include <QRegularExpression>
+#include <QSet>
+#include <QTextBlock>
 #include <QTextCharFormat>
 #include <QTextCursor>
 #include <QTextDocumentFragment>
 #include <QTextEdit>
 #include <QTextFrame>
+#include <QTimer>
 #include <QUrl>
 #include <QVariant>
+#ifndef WIDGET_PLUGIN
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#endif
 
 #include <cmath>
 
@@ -179,6 +191,172 @@ TextMarkerFormat::TextMarkerFormat(const QString &id) : QTextCharFormat()
     QTextFormat::setProperty(MarkerId, id);
 }
 
+//----------------------------------------------------------------------------
+// ImageResourceLoader
+//----------------------------------------------------------------------------
+
+#define IMAGE_CACHE_SIZE (32 * 1024 * 1024)      // bytes of decoded images shared by all documents
+#define DOCUMENT_IMAGES_LIMIT (64 * 1024 * 1024) // bytes of images added to one document
+
+// Image resources added to a document. Lives as a child of the document.
+// Images decoded in one event loop pass are laid out in a single walk over
+// the document, so a burst of images doesn't cost a walk per image.
+class DocumentImages : public QObject {
+public:
+    DocumentImages(QTextDocument *doc) : QObject(doc), doc_(doc) { }
+
+    QSet<QString>          urls;
+    QHash<QString, qint64> sizes; // of the decoded images
+    qint64                 bytes = 0;
+
+    // drops the images which aren't referenced by the document anymore (e.g. after a scrollback trim).
+    // done at most once per event loop pass
+    void collect()
+    {
+        if (collected_) {
+            return;
+        }
+        collected_ = true;
+        schedule();
+
+        QSet<QString> used;
+        for (QTextBlock block = doc_->begin(); block != doc_->end(); block = block.next()) {
+            for (auto it = block.begin(); !it.atEnd(); ++it) {
+                QTextFormat format = it.fragment().charFormat();
+                if (format.isImageFormat()) {
+                    used.insert(format.toImageFormat().name());
+                }
+            }
+        }
+
+        for (auto it = sizes.begin(); it != sizes.end();) {
+            if (used.contains(it.key())) {
+                ++it;
+                continue;
+            }
+            bytes -= it.value();
+            urls.remove(it.key());
+            doc_->addResource(QTextDocument::ImageResource, QUrl(it.key()), QVariant()); // frees the image
+            it = sizes.erase(it);
+        }
+    }
+
+    // placeholders of \a url were laid out with the old resource
+    void relayout(const QString &url)
+    {
+        replaced_.insert(url);
+        schedule();
+    }
+
+private:
+    void schedule()
+    {
+        if (!scheduled_) {
+            scheduled_ = true;
+            QTimer::singleShot(0, this, &DocumentImages::update);
+        }
+    }
+
+    void update()
+    {
+        if (!replaced_.isEmpty()) {
+            for (QTextBlock block = doc_->begin(); block != doc_->end(); block = block.next()) {
+                for (auto it = block.begin(); !it.atEnd(); ++it) {
+                    QTextFragment fragment = it.fragment();
+                    QTextFormat   format   = fragment.charFormat();
+                    if (format.isImageFormat() && replaced_.contains(format.toImageFormat().name())) {
+                        doc_->markContentsDirty(fragment.position(), fragment.length());
+                    }
+                }
+            }
+            replaced_.clear();
+        }
+        collected_ = false;
+        scheduled_ = false;
+    }
+
+    QTextDocument *doc_;
+    QSet<QString>  replaced_; // urls of images decoded since the last update
+    bool           collected_ = false;
+    bool           scheduled_ = false;
+};
+
+static qint64 imageBytes(const QImage &image) { return qint64(image.bytesPerLine()) * image.height(); }
+
+static void setDocumentImage(QTextDocument *doc, const QString &url, const QImage &image)
+{
+    auto   images = doc->findChild<DocumentImages *>(QString(), Qt::FindDirectChildrenOnly);
+    qint64 size   = imageBytes(image);
+    if (images && images->bytes + size > DOCUMENT_IMAGES_LIMIT) {
+        images->collect();
+    }
+    if (!images || images->bytes + size > DOCUMENT_IMAGES_LIMIT) {
+        qDebug("PsiRichText: too many images in the document. %s is not shown", qPrintable(url));
+        return;
+    }
+    images->bytes += size - images->sizes.value(url);
+    images->sizes.insert(url, size);
+    doc->addResource(QTextDocument::ImageResource, QUrl(url), image);
+    images->relayout(url);
+}
+
+// Decodes images in worker threads. The same image requested by several
+// documents is decoded once and the recently decoded ones are kept in memory.
+class ImageResourceLoader {
+public:
+    static ImageResourceLoader *instance()
+    {
+        static ImageResourceLoader loader;
+        return &loader;
+    }
+
+    void load(QTextDocument *doc, const QString &url, const std::function<QImage()> &decode)
+    {
+        QImage *image = cache_.object(url);
+        if (image) {
+            setDocumentImage(doc, url, *image);
+            return;
+        }
+
+        auto it = pending_.find(url);
+        if (it != pending_.end()) {
+            it.value().append(doc);
+            return;
+        }
+        pending_.insert(url, { doc });
+#ifdef WIDGET_PLUGIN
+        finished(url, decode());
+#else
+        auto watcher = new QFutureWatcher<QImage>();
+        QObject::connect(watcher, &QFutureWatcherBase::finished, [this, watcher, url]() {
+            finished(url, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([decode]() { return decode(); }));
+#endif
+    }
+
+private:
+    ImageResourceLoader() { cache_.setMaxCost(IMAGE_CACHE_SIZE); }
+
+    void finished(const QString &url, const QImage &image)
+    {
+        const auto docs = pending_.take(url);
+        if (image.isNull()) {
+            return;
+        }
+        cache_.insert(url, new QImage(image), int(qMin(imageBytes(image), qint64(IMAGE_CACHE_SIZE) + 1)));
+        for (const auto &doc : docs) {
+            if (doc) {
+                setDocumentImage(doc, url, image);
+            }
+        }
+    }
+
+    QCache<QString, QImage>                        cache_;
+    QHash<QString, QList<QPointer<QTextDocument>>> pending_;
+};
+
 //----------------------------------------------------------------------------
 // PsiRichText
 //----------------------------------------------------------------------------
@@ -414,8 +592,10 @@ static void appendTextHelper(QTextDocument *doc, QString text, QTextCursor &curs
     // prepare images and remove insecure images
     static QRegExp imgRe("<img[^>]+src\\s*=\\s*(\"[^\"]*\"|'[^']*')[^>]*>");
     QString        replace;
+    QString        sizeAttrs; // of images decoded in background
     for (int pos = 0; (pos = imgRe.indexIn(text, pos)) != -1;) {
         replace.clear();
+        sizeAttrs.clear();
         QString imgSrc    = imgRe.cap(1).mid(1, imgRe.cap(1).size() - 2);
         QUrl    imgSrcUrl = QUrl::fromEncoded(imgSrc.toLatin1());
         if (imgSrcUrl.isValid()) {
@@ -424,8 +604,19 @@ static void appendTextHelper(QTextDocument *doc, QString text, QTextCursor &curs
                 if (dataRe.indexIn(imgSrcUrl.path()) != -1) {
                     const QByteArray ba = QByteArray::fromBase64(dataRe.cap(1).toLatin1());
                     if (!ba.isNull()) {
+                        // only the header is read here. the image is decoded in background
+                        QBuffer buffer;
+                        buffer.setData(ba);
+                        buffer.open(QIODevice::ReadOnly);
+                        QSize  size = QImageReader(&buffer).size();
                         QImage image;
-                        if (image.loadFromData(ba)) {
+                        if (size.isValid()) {
+                            replace = "srcdata" + QCryptographicHash::hash(ba, QCryptographicHash::Sha1).toHex();
+                            PsiRichText::addImageResource(doc, QUrl(replace), [ba]() { return QImage::fromData(ba); });
+                            if (!imgRe.cap(0).contains("width") && !imgRe.cap(0).contains("height")) {
+                                sizeAttrs = QString(" width=\"%1\" height=\"%2\"").arg(size.width()).arg(size.height());
+                            }
+                        } else if (image.loadFromData(ba)) {
                             replace = "srcdata" + QCryptographicHash::hash(ba, QCryptographicHash::Sha1).toHex();
                             doc->addResource(QTextDocument::ImageResource, QUrl(replace), image);
                         }
@@ -459,7 +650,8 @@ static void appendTextHelper(QTextDocument *doc, QString text, QTextCursor &curs
             text.remove(pos, imgRe.matchedLength());
         } else {
             text.replace(imgRe.pos(1) + 1, imgSrc.size(), replace);
-            pos += replace.size() + 1;
+            text.insert(imgRe.pos(1) + replace.size() + 2, sizeAttrs);
+            pos += replace.size() + sizeAttrs.size() + 1;
         }
     }
 
@@ -584,6 +776,38 @@ void PsiRichText::addEmoticon(QTextEdit *textEdit, const QString &emoticon)
 
 void PsiRichText::setAllowedImageDirs(const QStringList &dirs) { allowedImageDirs = dirs; }
 
+/**
+ * Adds image resource \a url to \a doc. The image is made by \a decode in a worker
+ * thread and a transparent placeholder is shown until it's ready, so the size of the
+ * image should be known to the document (e.g. from width and height attributes).
+ */
+void PsiRichText::addImageResource(QTextDocument *doc, const QUrl &url, const std::function<QImage()> &decode)
+{
+    auto images = doc->findChild<DocumentImages *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!images) {
+        images = new DocumentImages(doc);
+    }
+    QString name = url.toString();
+    if (images->urls.contains(name)) {
+        if (doc->resource(QTextDocument::ImageResource, url).isValid()) {
+            return; // already added or being decoded
+        }
+        // resources are gone with QTextDocument::clear()
+        images->urls.clear();
+        images->sizes.clear();
+        images->bytes = 0;
+    }
+    images->urls.insert(name);
+
+    static QImage placeholder;
+    if (placeholder.isNull()) {
+        placeholder = QImage(1, 1, QImage::Format_ARGB32);
+        placeholder.fill(Qt::transparent);
+    }
+    doc->addResource(QTextDocument::ImageResource, url, placeholder);
+    ImageResourceLoader::instance()->load(doc, name, decode);
+}
+
 QTextCharFormat PsiRichText::markerFormat(const QString &uniqueId) { return TextMarkerFormat(uniqueId); }
 
 void PsiRichText::insertMarker(QTextCursor &cursor, const QString &uniqueId)
@@ -17,8 +17,10 @@
  *
  */
 
+#include <QImage>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QUrl>
 
 #include <functional>
 
@@ -40,6 +42,7 @@ public:
                            const ParsersMap &parsers = ParsersMap());
     static void addEmoticon(QTextEdit *textEdit, const QString &emoticon);
     static void setAllowedImageDirs(const QStringList &);
+    static void addImageResource(QTextDocument *doc, const QUrl &url, const std::function<QImage()> &decode);
 
     static QString convertToPlainText(const QTextDocument *doc);
 
@@ -20,6 +20,7 @@
 #include "psitextview.h"
 
 #include <QAbstractTextDocumentLayout>
+#include <QImageReader>
 #include <QMenu>
 #include <QMimeData>
 #include <QRegExp>
@@ -129,10 +130,27 @@ span.emojis {
                   QUrl    url(anchorName);
 
                   if (item->isCached()) {
-                      QVariant         vimg = document()->resource(QTextDocument::ImageResource, url);
                       QTextImageFormat fmt;
                       fmt.setName(url.toString());
-                      QImage img;
+
+                      // decode the preview in background if its size is known in advance
+                      QString fileName = item->fileName();
+                      QSize   size     = QImageReader(fileName).size();
+                      if (size.isValid()) {
+                          if (size.width() > 640 || size.height() > 480)
+                              size.scale(640, 480, Qt::KeepAspectRatio);
+                          PsiRichText::addImageResource(document(), url, [fileName, size]() {
+                              QImageReader reader(fileName);
+                              reader.setScaledSize(size);
+                              return reader.read();
+                          });
+                          fmt.setWidth(size.width());
+                          fmt.setHeight(size.height());
+                          return { fmt, "" };
+                      }
+
+                      QVariant vimg = document()->resource(QTextDocument::ImageResource, url);
+                      QImage   img;
                       if (vimg.isValid()) {
                           img = vimg.value<QImage>();
                       } else {
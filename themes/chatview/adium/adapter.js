@@ -492,7 +492,9 @@ chat.util.updateObject(adapter, function(chat){
                                 if (data.nextOfGroup) {
                                     appendNextMessage(template.toString(data));
                                 } else {
+                                    var atBottom = nearBottom();
                                     appendMessage(template.toString(data));
+                                    chat.util.trimScrollback(document.getElementById("Chat"), atBottom);
                                 }
                                 if (data.mtype == "message" && data.local) {
                                     scrollToBottom();
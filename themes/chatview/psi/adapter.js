@@ -112,6 +112,7 @@ function psiThemeAdapter(chat) {
                     chat.util.siblingHtml(nextEl, html);
                 } else {
                     chat.util.appendHtml(shared.chatElement, html);
+                    chat.util.trimScrollback(shared.chatElement, shared.scroller.atBottom, trackbar);
                 }
                 shared.scroller.invalidate();
             },
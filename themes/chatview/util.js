@@ -10,6 +10,7 @@ function initPsiTheme() {
     var serverTransctions = {};
     var uniqReplId = Number(0);
     var previewsEnabled = true;
+    var scrollbackSize = 0;
     var optionChangeHandlers = {}
 
     function BackForthScollerPausedAnimation(start, stop, callback)
@@ -412,6 +413,26 @@ function initPsiTheme() {
                 while (htmlSource.firstChild) dest.parentNode.insertBefore(htmlSource.firstChild, dest);
             },
 
+            // removes the oldest message elements of dest when there are more than
+            // options.ui.chat.scrollback-size of them. if the user reads older messages
+            // (not atBottom) the log is allowed to grow up to twice the limit.
+            trimScrollback : function(dest, atBottom, keep) {
+                var excess = dest.childElementCount - scrollbackSize;
+                if (!scrollbackSize || excess <= 0 || (!atBottom && excess < scrollbackSize)) {
+                    return;
+                }
+                excess += Math.floor(scrollbackSize / 10); // so it's not done on each append
+                var el = dest.firstElementChild;
+                while (el && excess > 0) {
+                    var next = el.nextElementSibling;
+                    if (el !== keep && el.tagName != "SCRIPT" && el.tagName != "STYLE") {
+                        dest.removeChild(el);
+                        excess--;
+                    }
+                    el = next;
+                }
+            },
+
             ensureDeleted : function(id) {
                 if (id) {
                     var el = document.getElementById(id);
@@ -844,6 +865,9 @@ function initPsiTheme() {
         var updateShowPreviews = function(value) { previewsEnabled = value;  }
         chat.util.psiOption("options.ui.chat.show-previews", updateShowPreviews);
         chat.util.connectOptionChange("options.ui.chat.show-previews", updateShowPreviews)
+        var updateScrollbackSize = function(value) { scrollbackSize = value; }
+        chat.util.psiOption("options.ui.chat.scrollback-size", updateScrollbackSize);
+        chat.util.connectOptionChange("options.ui.chat.scrollback-size", updateScrollbackSize)
     } catch(e) {
         server.console("Failed to initialize adapter:" + e + "(Line:" + e.line + ")");
         chat.adapter = {